@@ -0,0 +1,216 @@
+// worst-case behaviour of the parser on pathological inputs
+// usage: adversarial [scale]
+//
+// every input gets a time per byte and a peak heap ceiling, a few times what an -O2 build needs,
+// and scalable inputs are also parsed at a quarter of their size to catch superlinear growth,
+// the nesting inputs are rejected at max_depth whatever their size and are not scaled
+// the program exits non-zero if any of them is exceeded, the input is not accepted/rejected as expected (by load(),
+// try_parse() and push_parser alike), try_parse() reports another error than the one expected, or an accepted
+// input does not dump back to valid json
+
+#include "bench_util.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+// heap accounting, every allocation carries a header with its size
+namespace {
+
+std::atomic<size_t> g_heap_now{ 0 };
+std::atomic<size_t> g_heap_peak{ 0 };
+
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+void* counted_alloc(size_t n) {
+	void* p = std::malloc(n + HEADER);
+	if (!p) throw std::bad_alloc();
+	*static_cast<size_t*>(p) = n;
+	size_t now = g_heap_now.fetch_add(n) + n;
+	size_t peak = g_heap_peak.load();
+	while (now > peak && !g_heap_peak.compare_exchange_weak(peak, now));
+	return static_cast<char*>(p) + HEADER;
+}
+
+void counted_free(void* p) noexcept {
+	if (!p) return;
+	void* base = static_cast<char*>(p) - HEADER;
+	g_heap_now.fetch_sub(*static_cast<size_t*>(base));
+	std::free(base);
+}
+
+}
+
+void* operator new(size_t n) { return counted_alloc(n); }
+void* operator new[](size_t n) { return counted_alloc(n); }
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, size_t) noexcept { counted_free(p); }
+
+namespace {
+
+struct adversarial_case {
+	const char* name;
+	std::function<std::string(double scale)> make;
+	bool accept;			// expected result of parsing
+	double max_ns_per_byte;	// parse + destroy time ceiling, per input byte
+	double max_heap_ratio;	// peak heap ceiling as a multiple of the input size
+	json17::parse_error error = json17::parse_error::ok;	// what try_parse() must report, ok to not check
+};
+
+// the largest allowed rise of the per-byte cost from a quarter of the input to all of it, inputs
+// smaller than MIN_GROWTH_BYTES at a quarter are too noisy to compare
+constexpr double MAX_GROWTH = 2;
+constexpr size_t MIN_GROWTH_BYTES = 16 << 10;
+
+std::string repeat(const std::string& s, size_t n) {
+	std::string out;
+	out.reserve(s.size() * n);
+	for (size_t i = 0; i < n; i++) out += s;
+	return out;
+}
+
+std::vector<adversarial_case> cases() {
+	return {
+		{ "deep arrays (100k)", [](double) {
+			size_t n = 100000;
+			return std::string(n, '[') + std::string(n, ']');
+		}, false, 1, 0.25 },
+		{ "deep objects (100k)", [](double) {
+			size_t n = 100000;
+			return repeat("{\"a\":", n) + "null" + std::string(n, '}');
+		}, false, 0.5, 0.1 },
+		{ "deep within limit (500)", [](double) {
+			return std::string(500, '[') + std::string(500, ']');
+		}, true, 400, 48 },
+		{ "escaped string (4 MB)", [](double k) {
+			return "\"" + repeat("\\n\\t\\\"\\\\\\u00e9\\/", size_t(4e6 / 16 * k)) + "\"";
+		}, true, 20, 1.25 },
+		{ "1M keys, long prefix", [](double k) {
+			std::string prefix(48, 'k');
+			size_t n = size_t(1000000 * k);
+			std::string s = "{";
+			for (size_t i = 0; i < n; i++) {
+				if (i) s += ',';
+				s += '"' + prefix + std::to_string(i) + "\":" + std::to_string(i % 10);
+			}
+			return s + "}";
+		}, true, 60, 6 },
+		{ "1000 numbers x 5000 digits", [](double k) {
+			size_t n = size_t(1000 * k);
+			std::string num = "-" + std::string(2500, '9') + "." + std::string(2500, '1');
+			std::string s = "[";
+			for (size_t i = 0; i < n; i++) s += (i ? "," : "") + num;
+			return s + "]";
+		}, true, 20, 1.5 },
+		{ "5000-digit exponents", [](double k) {
+			size_t n = size_t(1000 * k);
+			std::string num = "1e" + std::string(5000, '9');
+			std::string s = "[";
+			for (size_t i = 0; i < n; i++) s += (i ? "," : "") + num;
+			return s + "]";
+		}, true, 20, 1.5 },
+		{ "1M \\uD800 escapes", [](double k) {
+			return "\"" + repeat("\\uD800", size_t(1000000 * k)) + "\"";
+		}, true, 20, 1.5 },
+		{ "fraction without digits", [](double) {
+			return std::string("[1.,-0.e5]");
+		}, false, 100, 16 },
+		{ "trailing dot", [](double) {
+			return std::string("1.");
+		}, false, 250, 16 },
+		{ "trailing dot in array", [](double) {
+			return std::string("[1.,2]");
+		}, false, 100, 16 },
+		{ "unknown escape", [](double) {
+			return std::string("\"a\\qb\"");
+		}, false, 100, 16 },
+		{ "truncated literal", [](double) {
+			return std::string("[true,nul");
+		}, false, 100, 16, json17::parse_error::unexpected_end },
+		{ "misspelt literal", [](double) {
+			return std::string("[true,nul]");
+		}, false, 100, 16, json17::parse_error::invalid_literal },
+		{ "1000 raw literals", [](double) {
+			std::string s = "[";
+			for (int i = 0; i < 1000; i++) s += (i ? ",-" : "-") + std::to_string(i) + ".0" + std::to_string(i) + "e-" + std::to_string(i % 400);
+			return s + "]";
+		}, true, 30, 6 },
+	};
+}
+
+struct measurement {
+	bool ok;
+	double ns_per_byte;		// best of a few runs, parse + destroy
+	double heap_ratio;		// peak heap over the input size
+};
+
+template<class Json>
+measurement measure(const std::string& input) {
+	constexpr int RUNS = 3;
+	measurement m{ false, 1e300, 0 };
+	for (int i = 0; i < RUNS; i++) {
+		size_t base = g_heap_now.load();
+		g_heap_peak.store(base);
+		auto t0 = bench::clock::now();
+		{
+			Json j;
+			m.ok = j.loads(input, true);
+		}
+		auto t1 = bench::clock::now();
+		m.ns_per_byte = std::min(m.ns_per_byte, double(bench::elapsed_ns(t0, t1)) / input.size());
+		m.heap_ratio = double(g_heap_peak.load() - base) / input.size();
+	}
+	return m;
+}
+
+template<class Json>
+bool run_case(const char* family, const adversarial_case& c, const std::string& input, const std::string& quarter) {
+	measurement m = measure<Json>(input);
+
+	// the cost per byte of a linear parser does not grow with the input, a quadratic one quadruples
+	double growth = 1;
+	if (quarter.size() >= MIN_GROWTH_BYTES) growth = m.ns_per_byte / measure<Json>(quarter).ns_per_byte;
+
+	// the validating entry points must agree with load()
+	auto res = Json::try_parse(input);
+	bool agree = bool(res) == m.ok && (c.error == json17::parse_error::ok || res.error == c.error);
+	typename Json::push_parser pp;
+	agree &= (pp.feed(input) && pp.finish()) == m.ok;
+
+	// whatever is accepted must dump as valid json again, json_raw writes the literals back as they were read
+	bool round_trip = true;
+	if (m.ok) {
+		Json j = Json::parse(input);
+		round_trip = Json().loads(j.dumps(), true);
+	}
+
+	bool pass = m.ok == c.accept && agree && round_trip && m.ns_per_byte <= c.max_ns_per_byte
+		&& growth <= MAX_GROWTH && m.heap_ratio <= c.max_heap_ratio;
+	printf("%-14s %-28s %10zu %8s %9.2f %8.1f %7.2f %9.2f %7.1f  %s\n", family, c.name, input.size(),
+		m.ok ? "accept" : "reject", m.ns_per_byte, c.max_ns_per_byte, growth, m.heap_ratio, c.max_heap_ratio,
+		pass ? "ok" : "FAILED");
+	return pass;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	double scale = argc > 1 ? atof(argv[1]) : 1.0;
+	printf("%-14s %-28s %10s %8s %9s %8s %7s %9s %7s\n",
+		"family", "input", "bytes", "result", "ns/byte", "max", "growth", "heap/in", "max");
+
+	bool all = true;
+	for (auto& c : cases()) {
+		std::string input = c.make(scale);
+		std::string quarter = c.make(scale / 4);
+		all &= run_case<json17::json>("json", c, input, quarter);
+		all &= run_case<json17::json_shared>("json_shared", c, input, quarter);
+		all &= run_case<json17::json_inplace>("json_inplace", c, input, quarter);
+		all &= run_case<json17::json_raw>("json_raw", c, input, quarter);
+	}
+	return all ? 0 : 1;
+}
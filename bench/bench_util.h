@@ -0,0 +1,178 @@
+#pragma once
+
+// shared helpers for the benchmarks in this directory, not part of the library
+
+#include "../json17/json17.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+using clock = std::chrono::steady_clock;
+
+inline uint64_t elapsed_ns(clock::time_point from, clock::time_point to) {
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+inline int highest_bit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(v);
+#else
+	int n = 0;
+	while (v >>= 1) n++;
+	return n;
+#endif
+}
+
+// log-linear histogram in the spirit of HdrHistogram
+// values below SUB_N are counted exactly, larger values are grouped by their highest set bit
+// and each group is split into SUB_N linear sub-buckets, so reported values are within 2^-SUB_BITS
+class histogram
+{
+public:
+	static constexpr int SUB_BITS = 7;
+	static constexpr int SUB_N = 1 << SUB_BITS;
+	static constexpr int GROUPS = 64 - SUB_BITS + 1;
+
+	histogram() : m_counts(size_t(GROUPS) * SUB_N) {}
+
+	void record(uint64_t v) {
+		++m_counts[index_of(v)];
+		++m_total;
+		m_sum += v;
+		if (v > m_max) m_max = v;
+	}
+
+	void merge(const histogram& other) {
+		for (size_t i = 0; i < m_counts.size(); i++) m_counts[i] += other.m_counts[i];
+		m_total += other.m_total;
+		m_sum += other.m_sum;
+		m_max = std::max(m_max, other.m_max);
+	}
+
+	uint64_t count() const { return m_total; }
+	uint64_t max() const { return m_max; }
+	double mean() const { return m_total ? double(m_sum) / m_total : 0; }
+
+	// highest value equivalent to the bucket holding the p-th percentile, 0 < p <= 100
+	uint64_t percentile(double p) const {
+		if (m_total == 0) return 0;
+		uint64_t target = uint64_t(p / 100 * m_total + 0.5);
+		if (target == 0) target = 1;
+		uint64_t seen = 0;
+		for (size_t i = 0; i < m_counts.size(); i++) {
+			seen += m_counts[i];
+			if (seen >= target) return std::min(upper_of(i), m_max);
+		}
+		return m_max;
+	}
+
+private:
+	std::vector<uint64_t> m_counts;
+	uint64_t m_total = 0;
+	uint64_t m_sum = 0;
+	uint64_t m_max = 0;
+
+	static size_t index_of(uint64_t v) {
+		if (v < SUB_N) return size_t(v);
+		int shift = highest_bit(v) - SUB_BITS;
+		return size_t(shift + 1) * SUB_N + size_t((v >> shift) - SUB_N);
+	}
+
+	static uint64_t upper_of(size_t idx) {
+		if (idx < SUB_N) return idx;
+		int shift = int(idx / SUB_N) - 1;
+		uint64_t sub = idx % SUB_N + SUB_N;
+		return ((sub + 1) << shift) - 1;
+	}
+};
+
+inline void print_latency_header() {
+	printf("%-14s %7s %-6s %10s %9s %9s %9s %9s %10s\n",
+		"family", "threads", "op", "count", "mean", "p50", "p99", "p99.9", "max");
+}
+
+inline void print_latency_row(const char* family, unsigned threads, const char* op, const histogram& h) {
+	printf("%-14s %7u %-6s %10llu %9.0f %9llu %9llu %9llu %10llu\n",
+		family, threads, op, (unsigned long long)h.count(), h.mean(),
+		(unsigned long long)h.percentile(50), (unsigned long long)h.percentile(99),
+		(unsigned long long)h.percentile(99.9), (unsigned long long)h.max());
+}
+
+// builds a fixed, seeded corpus of compact json documents whose sizes are spread
+// log-uniformly over [min_size, max_size], mixing flat records, numeric arrays,
+// nested objects and escape-heavy strings
+inline std::vector<std::string> make_corpus(size_t count, size_t min_size = 100, size_t max_size = 4096, uint64_t seed = 42) {
+	using json = json17::json;
+	std::mt19937_64 rng(seed);
+	std::uniform_real_distribution<double> unit(0, 1);
+	auto word = [&](size_t len) {
+		static const char chars[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+		std::string s;
+		for (size_t i = 0; i < len; i++) s += chars[rng() % (sizeof(chars) - 1)];
+		return s;
+	};
+	auto text = [&](size_t len) {
+		static const char* pieces[] = { "plain ", "quote\" ", "back\\slash ", "tab\t", "line\n", "\xe4\xbd\xa0\xe5\xa5\xbd ", "\xf0\x9f\x98\x80 " };
+		std::string s;
+		while (s.size() < len) s += pieces[rng() % 7];
+		return s;
+	};
+	auto record = [&](json& obj) {
+		obj["id"] = json::number(rng() % 1000000);
+		obj["name"] = word(4 + rng() % 12);
+		obj["active"] = rng() % 2 == 0;
+		obj["score"] = unit(rng) * 1000;
+		obj["note"] = rng() % 4 ? json(nullptr) : json(text(8 + rng() % 24));
+	};
+
+	std::vector<std::string> corpus;
+	corpus.reserve(count);
+	while (corpus.size() < count) {
+		size_t target = size_t(min_size * std::pow(double(max_size) / min_size, unit(rng)));
+		json doc;
+		int shape = int(corpus.size() % 4);
+		for (size_t n = 0; doc.dumps().size() < target; n++) {
+			switch (shape) {
+			case 0: record(doc[word(3 + rng() % 10)]); break;
+			case 1: doc[n] = rng() % 2 ? json(unit(rng) * 1e6 - 5e5) : json::number(int(rng() % 100000)); break;
+			case 2: {
+				json& item = doc["items"][n];
+				record(item);
+				item["children"][0]["tag"] = word(5);
+				item["children"][1]["tag"] = word(7);
+				break;
+			}
+			default: doc[word(6)] = text(16 + rng() % 96); break;
+			}
+		}
+		corpus.push_back(doc.dumps());
+	}
+	return corpus;
+}
+
+// runs fn(thread_index) on n threads, releasing them all at once
+template<class Fn>
+void run_threads(unsigned n, Fn&& fn) {
+	std::atomic<bool> go{ false };
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < n; i++) {
+		threads.emplace_back([&, i] {
+			while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+			fn(i);
+		});
+	}
+	go.store(true, std::memory_order_release);
+	for (auto& t : threads) t.join();
+}
+
+}
@@ -0,0 +1,79 @@
+// tail latency of small-message parse/dump round trips
+// usage: latency [threads] [iterations per thread]
+//
+// every operation is timed on its own and recorded into a log-linear histogram, so
+// allocator stalls and rebalancing hiccups show up in p99/p99.9/max instead of being
+// averaged away as they are in throughput numbers
+
+#include "bench_util.h"
+
+#include <cstdlib>
+
+namespace {
+
+struct latency_result {
+	bench::histogram parse;
+	bench::histogram dump;
+};
+
+template<class Json>
+void run_ops(const std::vector<std::string>& corpus, size_t iterations, size_t offset, latency_result& res) {
+	size_t n = corpus.size();
+	// warm up caches and allocator pools before recording
+	for (size_t i = 0; i < n; i++) Json::parse(corpus[i]).dumps();
+
+	for (size_t i = 0; i < iterations; i++) {
+		const std::string& doc = corpus[(i + offset) % n];
+		Json j;
+		auto t0 = bench::clock::now();
+		j.loads(doc);
+		auto t1 = bench::clock::now();
+		auto out = j.dumps();
+		auto t2 = bench::clock::now();
+		res.parse.record(bench::elapsed_ns(t0, t1));
+		res.dump.record(bench::elapsed_ns(t1, t2));
+		if (out.empty()) std::abort();
+	}
+}
+
+template<class Json>
+void run_family(const char* family, const std::vector<std::string>& corpus, unsigned threads, size_t iterations) {
+	latency_result single;
+	run_ops<Json>(corpus, iterations, 0, single);
+	bench::print_latency_row(family, 1, "parse", single.parse);
+	bench::print_latency_row(family, 1, "dump", single.dump);
+	if (threads <= 1) return;
+
+	std::vector<latency_result> per_thread(threads);
+	bench::run_threads(threads, [&](unsigned idx) {
+		run_ops<Json>(corpus, iterations, idx * 7919, per_thread[idx]);
+	});
+	latency_result merged;
+	for (auto& r : per_thread) {
+		merged.parse.merge(r.parse);
+		merged.dump.merge(r.dump);
+	}
+	bench::print_latency_row(family, threads, "parse", merged.parse);
+	bench::print_latency_row(family, threads, "dump", merged.dump);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned threads = argc > 1 ? unsigned(atoi(argv[1])) : std::thread::hardware_concurrency();
+	size_t iterations = argc > 2 ? size_t(atoll(argv[2])) : 200000;
+	if (threads == 0) threads = 1;
+
+	auto corpus = bench::make_corpus(512);
+	size_t total = 0;
+	for (auto& doc : corpus) total += doc.size();
+	printf("corpus: %zu documents, %zu bytes on average, latencies in ns\n\n", corpus.size(), total / corpus.size());
+
+	bench::print_latency_header();
+	run_family<json17::json>("json", corpus, threads, iterations);
+	run_family<json17::json_shared>("json_shared", corpus, threads, iterations);
+	run_family<json17::json_inplace>("json_inplace", corpus, threads, iterations);
+	run_family<json17::json_pool>("json_pool", corpus, threads, iterations);
+	return 0;
+}
@@ -0,0 +1,122 @@
+// multi-core scaling of independent parse/dump workloads
+// usage: scaling [max threads] [ops per thread]
+//
+// each thread parses and dumps its own documents, so any loss of efficiency comes from
+// state shared behind the scenes; a few probes of known global bottlenecks are scaled the
+// same way, so a sub-linear workload can be matched with the probe that degrades alike
+
+#include "bench_util.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+
+namespace {
+
+constexpr double FLAG_EFFICIENCY = 0.75;
+
+// runs body(thread_index, ops) on n threads and returns operations per second
+double throughput(unsigned n, size_t ops, const std::function<void(unsigned, size_t)>& body) {
+	auto t0 = bench::clock::now();
+	bench::run_threads(n, [&](unsigned idx) { body(idx, ops); });
+	auto t1 = bench::clock::now();
+	return double(ops) * n / (bench::elapsed_ns(t0, t1) / 1e9);
+}
+
+std::vector<unsigned> thread_counts(unsigned max_threads) {
+	std::vector<unsigned> counts;
+	for (unsigned n = 1; n < max_threads; n *= 2) counts.push_back(n);
+	counts.push_back(max_threads);
+	return counts;
+}
+
+void scale(const char* family, const char* workload, unsigned max_threads, size_t ops,
+	const std::function<void(unsigned, size_t)>& body) {
+	double base = 0;
+	for (unsigned n : thread_counts(max_threads)) {
+		double tput = throughput(n, ops, body);
+		if (n == 1) base = tput;
+		double eff = tput / (base * n);
+		printf("%-14s %-16s %7u %14.0f %9.2f%s\n", family, workload, n, tput, eff,
+			eff < FLAG_EFFICIENCY ? "  <- sub-linear" : "");
+	}
+}
+
+template<class Json>
+void scale_family(const char* family, const std::vector<std::string>& corpus, unsigned max_threads, size_t ops) {
+	size_t n = corpus.size();
+	scale(family, "parse", max_threads, ops, [&](unsigned idx, size_t ops) {
+		for (size_t i = 0; i < ops; i++) {
+			Json j;
+			if (!j.loads(corpus[(i + idx * 131) % n], true)) std::abort();
+		}
+	});
+
+	std::vector<Json> docs;
+	for (auto& doc : corpus) docs.push_back(Json::parse(doc));
+	scale(family, "dump", max_threads, ops, [&](unsigned idx, size_t ops) {
+		size_t total = 0;
+		for (size_t i = 0; i < ops; i++) total += docs[(i + idx * 131) % n].dumps().size();
+		if (total == 0) std::abort();
+	});
+
+	scale(family, "parse+dump", max_threads, ops, [&](unsigned idx, size_t ops) {
+		for (size_t i = 0; i < ops; i++) {
+			if (Json::parse(corpus[(i + idx * 131) % n]).dumps().empty()) std::abort();
+		}
+	});
+}
+
+// probes of process-wide state that a parse/dump workload may touch
+void scale_probes(unsigned max_threads, size_t ops) {
+	scale("probe", "malloc/free", max_threads, ops * 50, [](unsigned, size_t ops) {
+		std::vector<std::unique_ptr<char[]>> blocks(64);
+		for (size_t i = 0; i < ops; i++) blocks[i % 64].reset(new char[16 + i % 256]);
+	});
+
+	scale("probe", "snprintf %.17g", max_threads, ops * 10, [](unsigned idx, size_t ops) {
+		char buf[32];
+		for (size_t i = 0; i < ops; i++) snprintf(buf, sizeof(buf), "%.17g", i * 0.1 + idx);
+	});
+
+	scale("probe", "to_chars", max_threads, ops * 10, [](unsigned idx, size_t ops) {
+		char buf[32];
+		for (size_t i = 0; i < ops; i++) std::to_chars(buf, buf + sizeof(buf), i * 0.1 + idx, std::chars_format::general, 17);
+	});
+
+	// every thread takes handles to the same subtree, as readers of a json_shared document do
+	json17::json_shared shared = json17::json_shared::parse("{\"config\":{\"a\":1}}");
+	auto& root = shared.get_object();
+	scale("probe", "shared handles", max_threads, ops * 50, [&](unsigned, size_t ops) {
+		for (size_t i = 0; i < ops; i++) {
+			auto handle = root.begin()->second.get_shared_object();
+			if (!handle) std::abort();
+		}
+	});
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned max_threads = argc > 1 ? unsigned(atoi(argv[1])) : std::thread::hardware_concurrency();
+	size_t ops = argc > 2 ? size_t(atoll(argv[2])) : 20000;
+	if (max_threads == 0) max_threads = 1;
+
+	if (max_threads > std::thread::hardware_concurrency()) {
+		printf("warning: %u threads on %u hardware threads, efficiency above that is meaningless\n",
+			max_threads, std::thread::hardware_concurrency());
+	}
+
+	auto corpus = bench::make_corpus(512);
+	printf("scaling efficiency = throughput(n) / (n * throughput(1)), flagged below %.2f\n\n", FLAG_EFFICIENCY);
+	printf("%-14s %-16s %7s %14s %9s\n", "family", "workload", "threads", "ops/s", "eff");
+
+	scale_family<json17::json>("json", corpus, max_threads, ops);
+	scale_family<json17::json_shared>("json_shared", corpus, max_threads, ops);
+	scale_family<json17::json_inplace>("json_inplace", corpus, max_threads, ops);
+	scale_family<json17::json_pool>("json_pool", corpus, max_threads, ops);
+	scale_probes(max_threads, ops);
+	return 0;
+}
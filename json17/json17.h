@@ -1,11 +1,33 @@
 #pragma once
 
+#include <algorithm>	// min, max, clamp, sort
+#include <array>
+#include <atomic>
 #include <cassert>	// assert
+#include <charconv>	// to_chars
+#include <climits>	// INT_MAX
+#include <condition_variable>
+#include <cmath>	// isfinite, fabs, HUGE_VAL
+#include <cstdint>	// uint8_t
+#include <cstdio>	// EOF
+#include <cstdlib>	// abs
+#include <cstring>	// strlen, memset
+#include <deque>
+#include <exception>	// exception_ptr
+#include <functional>
 #include <iostream>	// ostream
+#include <limits>	// numeric_limits
 #include <map>
 #include <memory>	// unique_ptr
+#include <mutex>
+#include <new>	// align_val_t
+#include <optional>
 #include <stdexcept>	// out_of_range
 #include <string>
+#include <string_view>
+#include <thread>	// yield
+#include <unordered_map>
+#include <utility>	// exchange
 #include <variant>
 #include <vector>
 
@@ -13,6 +35,19 @@
 #pragma warning(disable: 4996)
 #endif
 
+#if __has_include(<sys/uio.h>) && __has_include(<unistd.h>)
+#define JSON17_HAS_WRITEV 1
+#include <cerrno>
+#include <system_error>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define JSON17_HAS_COROUTINES 1
+#include <coroutine>
+#endif
+
 
 namespace json17 {
 	
@@ -30,10 +65,115 @@ struct dump_options {
 	char indent_char;
 	bool ensure_ascii;
 
+	// members in byte order of their keys, for objects whose map_type is unordered
+	bool sort_keys = false;
+
+	// RFC 8785 (JCS) output: no whitespace, keys sorted by UTF-16 code units, ECMAScript number format,
+	// minimal escaping, indent and ensure_ascii are ignored and non-finite numbers throw std::invalid_argument
+	bool canonical = false;
+
 	dump_options(int indent = -1, char indent_char = ' ', bool ensure_ascii = false)
 		: indent(indent), indent_char(indent_char), ensure_ascii(ensure_ascii) {}
 };
 	
+// lets basic_json<>::deep_copy() split large trees across threads
+// subtrees of at least grain nodes are split further, smaller ones are copied by a single task
+struct parallel_policy {
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	size_t grain = 1 << 14;
+};
+
+struct parse_options {
+	// arrays and objects nested deeper than this are rejected, parsing recurses once per level
+	size_t max_depth;
+
+	parse_options(size_t max_depth = 512) : max_depth(max_depth) {}
+};
+
+enum class parse_error {
+	ok,
+	unexpected_end,
+	unexpected_character,
+	invalid_number,
+	invalid_escape,
+	invalid_literal,
+	too_deep,
+	trailing_characters
+};
+
+inline const char* to_string(parse_error e) noexcept {
+	switch (e) {
+	case parse_error::ok: return "ok";
+	case parse_error::unexpected_end: return "unexpected end of input";
+	case parse_error::unexpected_character: return "unexpected character";
+	case parse_error::invalid_number: return "invalid number";
+	case parse_error::invalid_escape: return "invalid escape";
+	case parse_error::invalid_literal: return "invalid literal";
+	case parse_error::too_deep: return "nested deeper than max_depth";
+	case parse_error::trailing_characters: return "characters after the value";
+	}
+	return "unknown error";
+}
+
+// the outcome of basic_json<>::try_parse(), the position refers to input, which must outlive line() and column()
+template<class Json>
+struct parse_result {
+	Json value;		// null after an error
+	parse_error error = parse_error::ok;
+	size_t offset = 0;		// byte offset of the offending byte, input.size() at an unexpected end
+	size_t consumed = 0;	// bytes read before parsing stopped
+	std::string_view input;
+
+	explicit operator bool() const noexcept { return error == parse_error::ok; }
+
+	// 1-based, counted when asked for
+	size_t line() const noexcept {
+		return 1 + std::count(input.begin(), input.begin() + std::min(offset, input.size()), '\n');
+	}
+	// 1-based, in bytes
+	size_t column() const noexcept {
+		size_t end = std::min(offset, input.size());
+		size_t nl = input.rfind('\n', end ? end - 1 : 0);
+		return nl == std::string_view::npos || nl >= end ? end + 1 : end - nl;
+	}
+};
+
+// FNV-1a, usable at compile time
+constexpr size_t hash_bytes(std::string_view s) noexcept {
+	uint64_t h = 14695981039346656037ull;
+	for (char c : s) h = (h ^ uint8_t(c)) * 1099511628211ull;
+	return size_t(h);
+}
+
+// an object key whose length and hash are worked out once, for lookups repeated over many objects
+//   static constexpr json17::key k_id{"id"};
+//   for (auto& rec : records.get_array()) total += rec[k_id].get_number();
+// only json_unordered from C++20 on uses the hash, with the std::map of the default traits a key is
+// looked up exactly as its std::string_view would be and gains nothing
+// the text is not copied and must outlive the key
+class key
+{
+public:
+	constexpr explicit key(std::string_view s) noexcept : m_str(s), m_hash(hash_bytes(s)) {}
+	constexpr explicit key(const char* s) noexcept : key(std::string_view(s)) {}
+
+	constexpr std::string_view str() const noexcept { return m_str; }
+	constexpr size_t size() const noexcept { return m_str.size(); }
+	constexpr size_t hash() const noexcept { return m_hash; }
+
+	// the length first, then the bytes
+	friend bool operator==(std::string_view s, const key& k) noexcept {
+		return s.size() == k.m_str.size() && std::memcmp(s.data(), k.m_str.data(), s.size()) == 0;
+	}
+	friend bool operator==(const key& k, std::string_view s) noexcept { return s == k; }
+	friend bool operator!=(std::string_view s, const key& k) noexcept { return !(s == k); }
+	friend bool operator!=(const key& k, std::string_view s) noexcept { return !(s == k); }
+
+private:
+	std::string_view m_str;
+	size_t m_hash;
+};
+
 struct json_traits {
 	using number_type = double;
 
@@ -42,8 +182,9 @@ struct json_traits {
 	template<class T>
 	using array_type = std::vector<T>;
 
+	// std::less<> lets objects be searched by std::string_view or a c-string without building a string
 	template<class K, class V>
-	using map_type = std::map<K, V>;
+	using map_type = std::map<K, V, std::less<>>;
 
 	template<class T>
 	using smart_pointer_type = std::unique_ptr<T>;
@@ -84,6 +225,319 @@ struct json_inplace_traits : json_traits {
 	}
 };
 
+// hash-based objects, for faster lookups in large objects, members are in no particular order
+// dump with dump_options::sort_keys for a stable output
+struct json_unordered_traits : json_traits {
+	// transparent, so from C++20 on lookups by std::string_view do not build a string either,
+	// and a json17::key brings its hash along
+	// not noexcept on purpose: libstdc++ then keeps the hash in each node and compares it before the strings
+	struct hash {
+		using is_transparent = void;
+		size_t operator()(std::string_view s) const { return hash_bytes(s); }
+		size_t operator()(const key& k) const { return k.hash(); }
+	};
+
+	template<class K, class V>
+	using map_type = std::unordered_map<K, V, hash, std::equal_to<>>;
+};
+
+// non-empty arrays whose elements are all numbers are parsed into a plain array_type<number_type>,
+// half the memory of an array of basic_json for double, see basic_json<>::get_packed()
+struct json_packed_traits : json_traits {
+	static constexpr bool pack_numeric_arrays = true;
+};
+
+// size-class free lists kept per thread, backing json_pool_traits
+// blocks up to MAX_SIZE bytes are carved from slabs and recycled through the free list of the
+// thread that allocated them, a block freed on another thread goes back to its owner through
+// a lock-free stack, larger requests fall through to ::operator new
+// a pool outlives its thread: on thread exit it is parked and adopted by the next new thread,
+// so cached memory is reused but never given back to the system
+class node_pool
+{
+public:
+	static constexpr size_t ALIGN = 16;
+	static constexpr size_t CLASSES = 16;	// 16, 32, ..., 256 bytes
+	static constexpr size_t MAX_SIZE = ALIGN * CLASSES;
+	static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+	static void* allocate(size_t n) {
+		if (n > MAX_SIZE) return ::operator new(n);
+		size_t c = _class_of(n);
+		pool& pl = _local();
+		block* b = pl.free_list[c];
+		if (!b) b = pl.remote[c].exchange(nullptr, std::memory_order_acquire);
+		if (!b) return pl.carve(c);
+		pl.free_list[c] = b->next;
+		return b;
+	}
+
+	static void deallocate(void* p, size_t n) noexcept {
+		if (!p) return;
+		if (n > MAX_SIZE) return ::operator delete(p);
+		size_t c = _class_of(n);
+		pool* owner = *reinterpret_cast<pool**>(static_cast<char*>(p) - ALIGN);
+		block* b = static_cast<block*>(p);
+		if (owner == _tl_pool()) {
+			b->next = owner->free_list[c];
+			owner->free_list[c] = b;
+		}
+		else {
+			b->next = owner->remote[c].load(std::memory_order_relaxed);
+			while (!owner->remote[c].compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed));
+		}
+	}
+
+private:
+	struct block { block* next; };
+
+	struct pool {
+		block* free_list[CLASSES] = {};
+		std::atomic<block*> remote[CLASSES] = {};	// freed by other threads, taken all at once by the owner
+		char* slab_cur = nullptr;
+		char* slab_end = nullptr;
+		pool* next_parked = nullptr;
+
+		// every block is preceded by ALIGN bytes holding its owner
+		void* carve(size_t c) {
+			size_t stride = ALIGN + (c + 1) * ALIGN;
+			if (size_t(slab_end - slab_cur) < stride) {
+				slab_cur = static_cast<char*>(::operator new(SLAB_SIZE));
+				slab_end = slab_cur + SLAB_SIZE;
+			}
+			*reinterpret_cast<pool**>(slab_cur) = this;
+			void* p = slab_cur + ALIGN;
+			slab_cur += stride;
+			return p;
+		}
+	};
+
+	inline static std::mutex s_parked_mutex;
+	inline static pool* s_parked = nullptr;
+
+	static size_t _class_of(size_t n) { return n ? (n - 1) / ALIGN : 0; }
+
+	static pool*& _tl_pool() {
+		static thread_local pool* p = nullptr;
+		return p;
+	}
+
+	struct park_on_exit {
+		~park_on_exit() {
+			pool*& p = _tl_pool();
+			std::lock_guard<std::mutex> lock(s_parked_mutex);
+			p->next_parked = s_parked;
+			s_parked = p;
+			p = nullptr;
+		}
+	};
+
+	static pool& _local() {
+		pool*& p = _tl_pool();
+		if (!p) {
+			{
+				std::lock_guard<std::mutex> lock(s_parked_mutex);
+				if (s_parked) {
+					p = s_parked;
+					s_parked = p->next_parked;
+				}
+			}
+			if (!p) p = new pool;
+			static thread_local park_on_exit guard;
+			(void)guard;
+		}
+		return *p;
+	}
+};
+
+// std::allocator replacement drawing from node_pool
+template<class T>
+struct pool_allocator {
+	using value_type = T;
+
+	pool_allocator() = default;
+	template<class U>
+	pool_allocator(const pool_allocator<U>&) noexcept {}
+
+	T* allocate(size_t n) {
+		static_assert(alignof(T) <= node_pool::ALIGN);	// here rather than in the class, T may be incomplete there
+		return static_cast<T*>(node_pool::allocate(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t n) noexcept { node_pool::deallocate(p, n * sizeof(T)); }
+
+	template<class U>
+	bool operator==(const pool_allocator<U>&) const noexcept { return true; }
+	template<class U>
+	bool operator!=(const pool_allocator<U>&) const noexcept { return false; }
+};
+
+template<class T>
+struct pool_deleter {
+	void operator()(T* p) const noexcept {
+		p->~T();
+		node_pool::deallocate(p, sizeof(T));
+	}
+};
+
+// nodes, map nodes and small array buffers come from node_pool, so destroying and rebuilding
+// documents in steady state rarely reaches the global allocator
+struct json_pool_traits : json_traits {
+	template<class T>
+	using array_type = std::vector<T, pool_allocator<T>>;
+
+	template<class K, class V>
+	using map_type = std::map<K, V, std::less<>, pool_allocator<std::pair<const K, V>>>;
+
+	template<class T>
+	using smart_pointer_type = std::unique_ptr<T, pool_deleter<T>>;
+
+	template<class T, class... Args>
+	static smart_pointer_type<T> make_smart(Args&&... args) {
+		void* p = node_pool::allocate(sizeof(T));
+		try {
+			return smart_pointer_type<T>(new(p) T(std::forward<Args>(args)...));
+		}
+		catch (...) {
+			node_pool::deallocate(p, sizeof(T));
+			throw;
+		}
+	}
+};
+
+// locale independent replacements of isspace() and isdigit(), also safe for negative chars
+// only the four whitespace characters of RFC 8259 are accepted
+inline bool is_space(char ch) { return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t'; }
+inline bool is_digit(char ch) { return unsigned(ch - '0') < 10u; }
+
+// from_chars leaves out of range values alone, they are +-inf or +-0 depending on the decimal exponent
+inline double _out_of_range(const char* first, const char* last) {
+	constexpr long long MAX_EXPONENT = 100000;
+	bool neg = *first == '-';
+	if (neg) ++first;
+	long long magnitude = -1;	// decimal exponent of the leading digit
+	bool nonzero = false;
+	for (; first != last && is_digit(*first); ++first) {
+		if (nonzero || *first != '0') nonzero = true, magnitude++;
+	}
+	if (first != last && *first == '.') {
+		for (++first; first != last && is_digit(*first); ++first) {
+			if (nonzero) continue;
+			if (*first != '0') nonzero = true;
+			else magnitude--;
+		}
+	}
+	long long expo = 0;
+	if (first != last && (*first == 'e' || *first == 'E')) {
+		bool eneg = *++first == '-';
+		if (*first == '+' || *first == '-') ++first;
+		for (; first != last && is_digit(*first); ++first) {
+			// saturate, anything beyond this is 0 or inf anyway
+			if (expo < MAX_EXPONENT) expo = expo * 10 + (*first - '0');
+		}
+		if (eneg) expo = -expo;
+	}
+	double d = magnitude + expo > 0 ? HUGE_VAL : 0.0;
+	return neg ? -d : d;
+}
+
+// convert a valid json number literal to the nearest double, correctly rounded
+inline double literal_to_double(const char* first, const char* last) {
+	double d = 0;
+	if (std::from_chars(first, last, d).ec == std::errc::result_out_of_range) d = _out_of_range(first, last);
+	return d;
+}
+
+// the end of the json number starting at p, or nullptr if there is none
+inline const char* _scan_number_literal(const char* p, const char* end) {
+	if (p != end && *p == '-') ++p;
+	if (p == end || !is_digit(*p)) return nullptr;
+	if (*p++ != '0') while (p != end && is_digit(*p)) ++p;
+	if (p != end && *p == '.') {
+		if (++p == end || !is_digit(*p)) return nullptr;
+		while (p != end && is_digit(*p)) ++p;
+	}
+	if (p != end && (*p == 'e' || *p == 'E')) {
+		if (++p != end && (*p == '+' || *p == '-')) ++p;
+		if (p == end || !is_digit(*p)) return nullptr;
+		while (p != end && is_digit(*p)) ++p;
+	}
+	return p;
+}
+
+// plain decimals such as 12.375 whose digits fit the mantissa of T and have at most 10 (float) or 22 (double)
+// decimals, here both the digits and the power of ten are exact in T, so one division rounds correctly
+template<class T>
+bool _fast_literal(const char* first, const char* last, T& out) {
+	constexpr int MAX_DECIMALS = std::numeric_limits<T>::digits > 24 ? 22 : 10;
+	constexpr uint64_t MAX_DIGITS = uint64_t(1) << std::min(std::numeric_limits<T>::digits, 63);
+	static constexpr T POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	bool neg = *first == '-';
+	if (neg) ++first;
+	uint64_t m = 0;
+	int n = 0, decimals = 0;
+	for (; first != last && is_digit(*first); ++first, ++n) m = m * 10 + (*first - '0');
+	if (first != last && *first == '.') {
+		for (++first; first != last && is_digit(*first); ++first, ++n, ++decimals) m = m * 10 + (*first - '0');
+	}
+	if (first != last || n > 19 || m > MAX_DIGITS || decimals > MAX_DECIMALS) return false;
+	T v = T(m) / POW10[decimals];
+	out = neg ? -v : v;
+	return true;
+}
+
+// d truncated toward zero, clamped to the range of the integer type T (nan becomes its minimum)
+template<class T>
+T _saturate(double d) noexcept {
+	if (!(d > double(std::numeric_limits<T>::min()))) return std::numeric_limits<T>::min();
+	if (!(d < double(std::numeric_limits<T>::max()))) return std::numeric_limits<T>::max();
+	return static_cast<T>(d);
+}
+
+// convert a valid json number literal to T, floating point types are rounded once, straight from
+// the digits, integers are exact if the literal is an integer in range, and saturate otherwise
+template<class T>
+T literal_to(const char* first, const char* last) {
+	static_assert(std::is_arithmetic_v<T>);
+	T v{};
+	if constexpr (std::is_floating_point_v<T>) {
+		if (_fast_literal(first, last, v)) return v;
+	}
+	auto res = std::from_chars(first, last, v);
+	if (res.ec == std::errc() && res.ptr == last) return v;
+	double d = literal_to_double(first, last);
+	if constexpr (std::is_integral_v<T>) return _saturate<T>(d);
+	else return static_cast<T>(d);
+}
+
+// decode a json array of numbers, e.g. "[1, 2.5, -3e2]", straight into out without building a basic_json,
+// e.g. to fill a float tensor, out is cleared first and keeps its capacity
+// returns false if input is anything else, out then holds the numbers before the offending byte
+template<class T, class Alloc>
+bool parse_numeric_array(std::string_view input, std::vector<T, Alloc>& out) {
+	out.clear();
+	const char* p = input.data();
+	const char* end = p + input.size();
+	auto skip_space = [&] { while (p != end && is_space(*p)) ++p; };
+	skip_space();
+	if (p == end || *p++ != '[') return false;
+	skip_space();
+	if (p != end && *p == ']') ++p;
+	else for (;;) {
+		const char* last = _scan_number_literal(p, end);
+		if (!last) return false;
+		out.push_back(literal_to<T>(p, last));
+		p = last;
+		skip_space();
+		if (p == end) return false;
+		if (*p++ == ']') break;
+		if (p[-1] != ',') return false;
+		skip_space();
+	}
+	skip_space();
+	return p == end;
+}
+
 template<class OutIt>
 class writer_interface;
 
@@ -96,6 +550,12 @@ public:
 	virtual void write(const char* str, size_t n) = 0;
 	virtual ~writer() = default;
 
+	// like write(), but str stays valid and unchanged until flush(), so a writer may keep the pointer instead of copying
+	virtual void write_ref(const char* str, size_t n) { write(str, n); }
+
+	// push out anything buffered, called at the end of dump(), errors are thrown from here rather than the destructor
+	virtual void flush() {}
+
 	// convenience functions
 	inline void write_c(const char* str) { write(str, strlen(str)); }
 
@@ -153,6 +613,116 @@ public:
 	void write(const char* str, size_t n = 0) override { ptr->write(str, n); }
 };
 
+#ifdef JSON17_HAS_WRITEV
+// a POSIX file descriptor (file, pipe or socket) for dump(), bypassing iostreams
+// output is gathered in an aligned buffer of buffer_size bytes and written with writev()
+// strings of at least ref_threshold bytes are not copied but handed to writev() as their own entries, 0 disables it
+struct fd_stream {
+	int fd;
+	size_t buffer_size = 1 << 20;
+	size_t ref_threshold = 1 << 14;
+};
+
+template<>
+class writer_interface<fd_stream> : public writer
+{
+public:
+	static constexpr size_t ALIGN = 4096;
+#ifdef IOV_MAX
+	static constexpr size_t MAX_IOV = IOV_MAX;
+#else
+	static constexpr size_t MAX_IOV = 16;	// the POSIX minimum
+#endif
+
+	writer_interface(fd_stream& target) : m_fd(target.fd), m_ref_threshold(target.ref_threshold) {
+		m_size = (std::max<size_t>(target.buffer_size, 1) + ALIGN - 1) / ALIGN * ALIGN;
+		m_buf = static_cast<char*>(::operator new(m_size, std::align_val_t(ALIGN)));
+	}
+
+	// flush() reports errors, here they can only be dropped
+	~writer_interface() {
+		try { flush(); }
+		catch (...) {}
+		::operator delete(m_buf, std::align_val_t(ALIGN));
+	}
+
+	writer_interface(const writer_interface&) = delete;
+	writer_interface& operator=(const writer_interface&) = delete;
+
+	void write(char ch) override {
+		if (m_used == m_size) flush();
+		m_buf[m_used++] = ch;
+	}
+
+	void write(const char* str, size_t n) override {
+		if (n <= m_size - m_used) {
+			memcpy(m_buf + m_used, str, n);
+			m_used += n;
+		}
+		else if (n < m_size) {
+			flush();
+			memcpy(m_buf, str, n);
+			m_used = n;
+		}
+		else {	// larger than the buffer, write it in place
+			_add_ref(str, n);
+			flush();
+		}
+	}
+
+	void write_ref(const char* str, size_t n) override {
+		if (m_ref_threshold == 0 || n < m_ref_threshold) return write(str, n);
+		_add_ref(str, n);
+	}
+
+	void flush() override {
+		_add_buffered();
+		iovec* iov = m_iov.data();
+		size_t cnt = m_iov.size();
+		while (cnt) {
+			ssize_t r = ::writev(m_fd, iov, int(std::min(cnt, MAX_IOV)));
+			if (r < 0) {
+				if (errno == EINTR) continue;
+				m_iov.clear();
+				m_used = m_mark = 0;
+				throw std::system_error(errno, std::generic_category(), "writev");
+			}
+			// skip what was written, a short write may stop in the middle of an entry
+			size_t done = size_t(r);
+			while (cnt && done >= iov->iov_len) done -= iov->iov_len, ++iov, --cnt;
+			if (cnt) {
+				iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+				iov->iov_len -= done;
+			}
+		}
+		m_iov.clear();
+		m_used = m_mark = 0;
+	}
+
+private:
+	// queue the buffered bytes since the last entry
+	void _add_buffered() {
+		if (m_used == m_mark) return;
+		m_iov.push_back({ m_buf + m_mark, m_used - m_mark });
+		m_mark = m_used;
+	}
+
+	void _add_ref(const char* str, size_t n) {
+		_add_buffered();
+		m_iov.push_back({ const_cast<char*>(str), n });
+		if (m_iov.size() >= MAX_IOV - 1) flush();
+	}
+
+	int m_fd;
+	size_t m_ref_threshold;
+	char* m_buf;
+	size_t m_size;
+	size_t m_used = 0;
+	size_t m_mark = 0;	// m_buf[0, m_mark) is already queued in m_iov
+	std::vector<iovec> m_iov;
+};
+#endif
+
 template<class Iter>
 class reader_interface;
 
@@ -168,7 +738,7 @@ public:
 
 	char nonspace_read() {
 		char ch;
-		do ch = read(); while (isspace(ch));
+		do ch = read(); while (is_space(ch));
 		return ch;
 	}
 
@@ -178,15 +748,23 @@ public:
 			return std::make_unique<reader_interface<std::istream>>(target);
 		}
 		else {
-			static_assert(std::is_base_of_v<reader, reader_interface<Target>>);
-			return std::make_unique<reader_interface<Target>>(target);
+			using type = reader_interface<std::remove_const_t<Target>>;
+			static_assert(std::is_base_of_v<reader, type>);
+			return std::make_unique<type>(target);
 		}
 	}
 
+	// wide characters are read through pointers, see _utf_reader
 	template<class Iter>
 	static std::unique_ptr<reader> New(Iter first, Iter last) {
-		static_assert(std::is_base_of_v<reader, reader_interface<Iter>>);
-		return std::make_unique<reader_interface<Iter>>(first, last);
+		using unit = std::remove_cv_t<typename std::iterator_traits<Iter>::value_type>;
+		if constexpr (std::is_pointer_v<Iter> && !std::is_same_v<unit, char>) {
+			return std::make_unique<reader_interface<const unit*>>(first, last);
+		}
+		else {
+			static_assert(std::is_base_of_v<reader, reader_interface<Iter>>);
+			return std::make_unique<reader_interface<Iter>>(first, last);
+		}
 	}
 };
 
@@ -194,7 +772,7 @@ template<class Iter>
 class reader_interface : public reader
 {
 public:
-	static_assert(std::is_same_v<std::iterator_traits<Iter>::value_type, char>);
+	static_assert(std::is_same_v<typename std::iterator_traits<Iter>::value_type, char>);
 
 	Iter first, last;
 	reader_interface(Iter first, Iter last) : first(first), last(last) {}
@@ -220,590 +798,3796 @@ public:
 	char read() override { return *it == '\0' ? EOF : *it++; }
 };
 
-
-template<class Traits = json_traits>
-class basic_json
+// a block of memory that knows how much of it was read, for basic_json<>::try_parse()
+class _span_reader : public reader
 {
 public:
-	using number = typename Traits::number_type;
-	using string = typename Traits::string_type;
-	using array  = typename Traits::template array_type<basic_json>;
-	using object = typename Traits::template map_type<string, basic_json>;
-
-	template<class T>
-	using smart_ptr = typename Traits::template smart_pointer_type<T>;
-
-	// make sure make_smart<> is consistent with smart_pointer_type<>
-	static_assert(std::is_same_v<smart_ptr<int>, decltype(Traits::template make_smart<int>())>);
+	_span_reader(const char* first, const char* last) : m_first(first), m_cur(first), m_last(last) {}
 
-	using sptr_string_t = typename smart_ptr<string>; // should be not-null
-	using sptr_array_t  = typename smart_ptr<array>;  // should be not-null
-	using sptr_object_t = typename smart_ptr<object>; // should be not-null
+	char read() override {
+		if (m_cur != m_last) return *m_cur++;
+		m_eof = true;
+		return EOF;
+	}
 
-	using variant_t = std::variant<std::nullptr_t, bool, number, sptr_string_t, sptr_array_t, sptr_object_t>;
+	size_t pos() const noexcept { return m_cur - m_first; }
+	// the last read() was past the end
+	bool eof() const noexcept { return m_eof && m_cur == m_last; }
 
 private:
-	variant_t m_var;
-
-	template<class T, class... Args>
-	static smart_ptr<T> _make_smart(Args&&... args) {
-		return Traits::template make_smart<T>(std::forward<Args>(args)...);
-	}
+	const char* m_first;
+	const char* m_cur;
+	const char* m_last;
+	bool m_eof = false;
+};
 
+// a reader over blocks of memory, for sources that produce data in large chunks (decompressors, transcoders)
+// derived classes point cur/end at the next block in refill()
+class buffered_reader : public reader
+{
 public:
-	basic_json() = default;
-	basic_json(std::nullptr_t)  : m_var(nullptr) {}
-	basic_json(bool v)          : m_var(v) {}
-	basic_json(number v)        : m_var(v) {}
-	basic_json(int v)           : m_var(number(v)) {}
-	basic_json(const string& v) : m_var(_make_smart<string>(v)) {}
-	basic_json(string&& v)      : m_var(_make_smart<string>(v)) {}
-	basic_json(const char* v)   : m_var(_make_smart<string>(v)) {}
-	basic_json(const array& v)  : m_var(_make_smart<array>(v)) {}
-	basic_json(array&& v)       : m_var(_make_smart<array>(v)) {}
-	basic_json(const object& v) : m_var(_make_smart<object>(v)) {}
-	basic_json(object&& v)      : m_var(_make_smart<object>(v)) {}
-
-	basic_json(basic_json&&) = default;
-	basic_json& operator=(basic_json&&) = default;
-
-	// make a deep copy even if using shared pointer
-	basic_json& operator=(const basic_json& other) {
-		// TODO use std::visit
-		switch (other.m_var.index()) {
-		case 0: m_var = nullptr; break;
-		case 1: m_var = other.get_bool(); break;
-		case 2: m_var = other.get_number(); break;
-		case 3: m_var = _make_smart<string>(other.get_string()); break;
-		case 4: m_var = _make_smart<array>(other.get_array()); break;
-		case 5: m_var = _make_smart<object>(other.get_object()); break;
-		}
-		return *this;
+	char read() override {
+		if (cur == end && !refill()) return EOF;
+		return *cur++;
 	}
-	basic_json(const basic_json& other) { operator=(other); }
 
-	variant_t&       get_variant()       noexcept { return m_var; }
-	const variant_t& get_variant() const noexcept { return m_var; }
-
-	json_type get_type() const noexcept { return (json_type)m_var.index(); }
-	bool is_null()   const noexcept { return m_var.index() == 0; }
-	bool is_bool()   const noexcept { return m_var.index() == 1; }
-	bool is_number() const noexcept { return m_var.index() == 2; }
-	bool is_string() const noexcept { return m_var.index() == 3; }
-	bool is_array()  const noexcept { return m_var.index() == 4; }
-	bool is_object() const noexcept { return m_var.index() == 5; }
+protected:
+	const char* cur = nullptr;
+	const char* end = nullptr;
 
-	bool&   get_bool()   { return std::get<bool>(m_var); }
-	number& get_number() { return std::get<number>(m_var); }
-	string& get_string() { return *std::get<sptr_string_t>(m_var); }
-	array&  get_array()  { return *std::get<sptr_array_t>(m_var); }
-	object& get_object() { return *std::get<sptr_object_t>(m_var); }
+	// return false at the end of input, otherwise leave at least one char in [cur, end)
+	virtual bool refill() = 0;
+};
 
-	bool          get_bool()   const { return std::get<bool>(m_var); }
-	number        get_number() const { return std::get<number>(m_var); }
-	int           get_int()    const { return static_cast<int>(get_number()); }
-	const string& get_string() const { return *std::get<sptr_string_t>(m_var); }
-	const array&  get_array()  const { return *std::get<sptr_array_t>(m_var); }
-	const object& get_object() const { return *std::get<sptr_object_t>(m_var); }
+// UTF-16 (2-byte units, e.g. char16_t, wchar_t on Windows) or UTF-32 (4-byte units) input, transcoded
+// to UTF-8 a block at a time as the parser reads it, so the document is never converted as a whole
+// runs of ASCII are copied a word of units at a time, unpaired surrogates and invalid code points
+// become U+FFFD, a leading byte order mark is skipped, units are in native byte order
+template<class Unit>
+class _utf_reader : public buffered_reader
+{
+public:
+	static_assert(sizeof(Unit) == 2 || sizeof(Unit) == 4);
 
-	string& set_string() { m_var = _make_smart<string>();  return get_string(); }
-	array&  set_array()  { m_var = _make_smart<array>();  return get_array(); }
-	object& set_object() { m_var = _make_smart<object>();  return get_object(); }
+	_utf_reader(const Unit* first, const Unit* last) : m_it(first), m_last(last) {
+		if (m_it != m_last && uint32_t(*m_it) == 0xFEFF) ++m_it;
+	}
 
-	// auto expand if idx >= get_array().size(), or create one if is_null()
-	// throws if *this is not null nor an array
-	basic_json& operator[](size_t idx) {
-		if (is_null()) {
-			m_var = _make_smart<array>(idx + 1);
-			return get_array()[idx];
+protected:
+	bool refill() override {
+		if (m_it == m_last) return false;
+		char* out = m_buf;
+		char* out_end = m_buf + BLOCK - 4;	// room for any code point
+		while (m_it != m_last && out < out_end) {
+			while (size_t(m_last - m_it) >= PER_WORD && size_t(out_end - out) >= PER_WORD) {
+				uint64_t w;
+				memcpy(&w, m_it, sizeof(w));
+				if (w & NON_ASCII) break;
+				for (size_t i = 0; i < PER_WORD; i++) out[i] = char(m_it[i]);
+				m_it += PER_WORD;
+				out += PER_WORD;
+			}
+			if (m_it == m_last) break;
+			out = _encode(_next(), out);
 		}
-		auto& arr = get_array();
-		if (arr.size() <= idx) arr.resize(idx + 1);
-		return arr[idx];
+		cur = m_buf;
+		end = out;
+		return true;
 	}
 
-	// array is immutable, must be array and does range check
-	const basic_json& operator[](size_t idx) const { return get_array().at(idx); }
+private:
+	static constexpr size_t BLOCK = 1 << 14;
+	static constexpr size_t PER_WORD = 8 / sizeof(Unit);
+	static constexpr uint64_t NON_ASCII = sizeof(Unit) == 2 ? 0xFF80FF80FF80FF80 : 0xFFFFFF80FFFFFF80;
 
-	// auto fill null if desired key does not exist, or create one if is_null()
-	// throws if *this is not null nor an object
-	basic_json& operator[](const string& key) {
-		if (is_null()) m_var = _make_smart<object>();
-		return get_object()[key];
+	uint32_t _next() {
+		uint32_t c = sizeof(Unit) == 2 ? uint32_t(uint16_t(*m_it++)) : uint32_t(*m_it++);
+		if (c < 0xD800 || (c >= 0xE000 && c <= 0x10FFFF)) return c;
+		if (sizeof(Unit) == 2 && c < 0xDC00 && m_it != m_last) {
+			uint32_t low = uint16_t(*m_it);
+			if (low >= 0xDC00 && low < 0xE000) {
+				++m_it;
+				return 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+			}
+		}
+		return 0xFFFD;
 	}
 
-	// object is immutable, the key must exist
-	const basic_json& operator[](const string& key) const {
-		auto& obj = get_object();
-		auto it = obj.find(key);
-		if (it == obj.end()) throw std::out_of_range("key does not exist");
-		return it->second;
+	static char* _encode(uint32_t c, char* out) {
+		if (c < 0x80) {
+			*out++ = char(c);
+		}
+		else if (c < 0x800) {
+			*out++ = char(0xC0 | c >> 6);
+			*out++ = char(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000) {
+			*out++ = char(0xE0 | c >> 12);
+			*out++ = char(0x80 | (c >> 6 & 0x3F));
+			*out++ = char(0x80 | (c & 0x3F));
+		}
+		else {
+			*out++ = char(0xF0 | c >> 18);
+			*out++ = char(0x80 | (c >> 12 & 0x3F));
+			*out++ = char(0x80 | (c >> 6 & 0x3F));
+			*out++ = char(0x80 | (c & 0x3F));
+		}
+		return out;
 	}
 
-	bool*   ptr_bool()   noexcept { return std::get_if<bool>(&m_var); }
-	number* ptr_number() noexcept { return std::get_if<number>(&m_var); }
-	string* ptr_string() noexcept { auto* ptr = std::get_if<sptr_string_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
-	array*  ptr_array()  noexcept { auto* ptr = std::get_if<sptr_array_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
-	object* ptr_object() noexcept { auto* ptr = std::get_if<sptr_object_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+	const Unit* m_it;
+	const Unit* m_last;
+	char m_buf[BLOCK];
+};
 
-	const bool*   ptr_bool()   const noexcept { return std::get_if<bool>(&m_var); }
-	const number* ptr_number() const noexcept { return std::get_if<number>(&m_var); }
-	const string* ptr_string() const noexcept { auto* ptr = std::get_if<sptr_string_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
-	const array*  ptr_array()  const noexcept { auto* ptr = std::get_if<sptr_array_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
-	const object* ptr_object() const noexcept { auto* ptr = std::get_if<sptr_object_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+template<>
+class reader_interface<std::u16string> : public _utf_reader<char16_t>
+{
+public:
+	reader_interface(const std::u16string& str) : _utf_reader(str.data(), str.data() + str.size()) {}
+};
 
-	// return the underlying smart pointer
-	// do not set to nullptr, will lead to nullptr dereference
-	sptr_string_t& sptr_string() { return std::get<sptr_string_t>(m_var); }
-	sptr_array_t&  sptr_array()  { return std::get<sptr_array_t>(m_var); }
-	sptr_object_t& sptr_object() { return std::get<sptr_object_t>(m_var); }
+template<>
+class reader_interface<std::u32string> : public _utf_reader<char32_t>
+{
+public:
+	reader_interface(const std::u32string& str) : _utf_reader(str.data(), str.data() + str.size()) {}
+};
+
+template<>
+class reader_interface<std::wstring> : public _utf_reader<wchar_t>
+{
+public:
+	reader_interface(const std::wstring& str) : _utf_reader(str.data(), str.data() + str.size()) {}
+};
+
+// a pointer pair, or a null-terminated string like reader_interface<const char*>
+template<>
+class reader_interface<const char16_t*> : public _utf_reader<char16_t>
+{
+public:
+	reader_interface(const char16_t* it) : _utf_reader(it, it + std::char_traits<char16_t>::length(it)) {}
+	reader_interface(const char16_t* first, const char16_t* last) : _utf_reader(first, last) {}
+};
+
+template<>
+class reader_interface<const char32_t*> : public _utf_reader<char32_t>
+{
+public:
+	reader_interface(const char32_t* it) : _utf_reader(it, it + std::char_traits<char32_t>::length(it)) {}
+	reader_interface(const char32_t* first, const char32_t* last) : _utf_reader(first, last) {}
+};
+
+template<>
+class reader_interface<const wchar_t*> : public _utf_reader<wchar_t>
+{
+public:
+	reader_interface(const wchar_t* it) : _utf_reader(it, it + std::char_traits<wchar_t>::length(it)) {}
+	reader_interface(const wchar_t* first, const wchar_t* last) : _utf_reader(first, last) {}
+};
+
+// SHA-256 (FIPS 180-4), the default hasher of basic_json<>::canonical_hash()
+class sha256
+{
+public:
+	using digest_type = std::array<uint8_t, 32>;
+
+	void update(const char* data, size_t n) {
+		m_length += n;
+		if (m_used) {
+			size_t k = std::min(n, 64 - m_used);
+			memcpy(m_block + m_used, data, k);
+			m_used += k, data += k, n -= k;
+			if (m_used < 64) return;
+			_compress(m_block);
+			m_used = 0;
+		}
+		for (; n >= 64; data += 64, n -= 64) _compress(reinterpret_cast<const uint8_t*>(data));
+		memcpy(m_block, data, n);
+		m_used = n;
+	}
+
+	digest_type digest() {
+		uint64_t bits = m_length * 8;
+		m_block[m_used++] = 0x80;
+		if (m_used > 56) {
+			memset(m_block + m_used, 0, 64 - m_used);
+			_compress(m_block);
+			m_used = 0;
+		}
+		memset(m_block + m_used, 0, 56 - m_used);
+		for (int i = 0; i < 8; i++) m_block[63 - i] = uint8_t(bits >> (i * 8));
+		_compress(m_block);
+
+		digest_type out;
+		for (int i = 0; i < 32; i++) out[i] = uint8_t(m_state[i / 4] >> (24 - i % 4 * 8));
+		return out;
+	}
+
+private:
+	static uint32_t _rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+	void _compress(const uint8_t* p) {
+		static constexpr uint32_t K[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+		};
+		uint32_t w[64];
+		for (int i = 0; i < 16; i++) w[i] = uint32_t(p[i * 4]) << 24 | p[i * 4 + 1] << 16 | p[i * 4 + 2] << 8 | p[i * 4 + 3];
+		for (int i = 16; i < 64; i++) {
+			uint32_t s0 = _rotr(w[i - 15], 7) ^ _rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = _rotr(w[i - 2], 17) ^ _rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+		uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+		uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+		for (int i = 0; i < 64; i++) {
+			uint32_t t1 = h + (_rotr(e, 6) ^ _rotr(e, 11) ^ _rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+			uint32_t t2 = (_rotr(a, 2) ^ _rotr(a, 13) ^ _rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			h = g, g = f, f = e, e = d + t1;
+			d = c, c = b, b = a, a = t1 + t2;
+		}
+		m_state[0] += a, m_state[1] += b, m_state[2] += c, m_state[3] += d;
+		m_state[4] += e, m_state[5] += f, m_state[6] += g, m_state[7] += h;
+	}
+
+	uint32_t m_state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	uint8_t m_block[64];
+	size_t m_used = 0;
+	uint64_t m_length = 0;
+};
+
+// feeds the output of dump() to a hasher with update(const char*, size_t), in blocks
+template<class Hasher>
+class hash_writer : public writer
+{
+public:
+	hash_writer(Hasher& hasher) : m_hasher(&hasher) {}
+	~hash_writer() { flush(); }
+
+	void write(char ch) override {
+		if (m_used == sizeof(m_buf)) flush();
+		m_buf[m_used++] = ch;
+	}
+	void write(const char* str, size_t n) override {
+		if (n > sizeof(m_buf) - m_used) {
+			flush();
+			if (n >= sizeof(m_buf)) return m_hasher->update(str, n);
+		}
+		memcpy(m_buf + m_used, str, n);
+		m_used += n;
+	}
+	void flush() override {
+		if (m_used) m_hasher->update(m_buf, m_used);
+		m_used = 0;
+	}
+
+private:
+	Hasher* m_hasher;
+	char m_buf[4096];
+	size_t m_used = 0;
+};
+
+// receives the events of basic_json<>::push_parser as soon as each token is complete
+// return false from any of them to stop parsing
+// numbers are reported as the literal text, use basic_json<>::parse() or std::from_chars() to convert
+class sax_handler
+{
+public:
+	virtual bool on_null() = 0;
+	virtual bool on_bool(bool v) = 0;
+	virtual bool on_number(const char* str, size_t n) = 0;
+	virtual bool on_string(const char* str, size_t n) = 0;
+	virtual bool on_key(const char* str, size_t n) = 0;
+	virtual bool on_start_array() = 0;
+	virtual bool on_end_array() = 0;
+	virtual bool on_start_object() = 0;
+	virtual bool on_end_object() = 0;
+	virtual ~sax_handler() = default;
+};
+
+template<class Traits>
+class basic_json;
+
+// runs tasks on a few threads until all are done, tasks may push more tasks
+// work stealing: each thread pushes and pops at the back of its own deque and, when that is empty,
+// steals from the front of the others, so threads only meet on the lock of a deque being stolen from
+class _task_pool
+{
+public:
+	explicit _task_pool(unsigned threads) : m_queues(std::max(threads, 1u)) {}
+
+	// a task pushed by a task goes to its thread's deque, anything else to the first one
+	void push(std::function<void()> task) {
+		size_t i = t_current.pool == this ? t_current.index : 0;
+		m_pending.fetch_add(1, std::memory_order_relaxed);
+		{
+			auto& q = m_queues[i];
+			std::lock_guard<std::mutex> lk(q.mutex);
+			q.tasks.push_back(std::move(task));
+			q.size.store(q.tasks.size(), std::memory_order_relaxed);
+		}
+		// seq_cst pairs with _work(), either the sleeper sees the push or the push sees the sleeper
+		m_pushes.fetch_add(1, std::memory_order_seq_cst);
+		if (m_sleeping.load(std::memory_order_seq_cst)) {
+			{ std::lock_guard<std::mutex> lk(m_idle); }
+			m_idle_cv.notify_one();
+		}
+	}
+
+	// work on the calling thread and threads - 1 helpers, rethrow the first exception of a task
+	void run() {
+		std::vector<std::thread> helpers;
+		for (size_t i = 1; i < m_queues.size(); i++) helpers.emplace_back([this, i] { _work(i); });
+		_work(0);
+		for (auto& t : helpers) t.join();
+		if (m_error) std::rethrow_exception(m_error);
+	}
+
+private:
+	struct alignas(64) queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+		std::atomic<size_t> size{ 0 };	// lets thieves skip empty deques without locking
+	};
+
+	struct current {
+		_task_pool* pool;
+		size_t index;
+	};
+	static inline thread_local current t_current{ nullptr, 0 };
+
+	void _work(size_t i) {
+		current saved = std::exchange(t_current, current{ this, i });
+		std::function<void()> task;
+		for (;;) {
+			uint64_t seen = m_pushes.load(std::memory_order_seq_cst);
+			if (_take(i, task)) {
+				if (!m_failed.load(std::memory_order_relaxed)) {
+					try {
+						task();
+					}
+					catch (...) {
+						std::lock_guard<std::mutex> lk(m_idle);
+						if (!m_error) m_error = std::current_exception();
+						m_failed.store(true, std::memory_order_relaxed);
+					}
+				}
+				task = nullptr;
+				if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					{ std::lock_guard<std::mutex> lk(m_idle); }
+					m_idle_cv.notify_all();
+				}
+				continue;
+			}
+			// nothing to take, sleep until a push or the end
+			std::unique_lock<std::mutex> lk(m_idle);
+			m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+			m_idle_cv.wait(lk, [&] {
+				return m_pending.load(std::memory_order_acquire) == 0 || m_pushes.load(std::memory_order_seq_cst) != seen;
+			});
+			m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+			if (m_pending.load(std::memory_order_acquire) == 0) break;
+		}
+		t_current = saved;
+	}
+
+	// newest of the own deque first, then the oldest, which tend to be the biggest, of the others
+	bool _take(size_t i, std::function<void()>& task) {
+		size_t n = m_queues.size();
+		for (size_t k = 0; k < n; k++) {
+			auto& q = m_queues[(i + k) % n];
+			if (q.size.load(std::memory_order_relaxed) == 0) continue;
+			std::lock_guard<std::mutex> lk(q.mutex);
+			if (q.tasks.empty()) continue;
+			if (k == 0) task = std::move(q.tasks.back()), q.tasks.pop_back();
+			else task = std::move(q.tasks.front()), q.tasks.pop_front();
+			q.size.store(q.tasks.size(), std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	std::vector<queue> m_queues;
+	std::atomic<size_t> m_pending{ 0 };		// queued or running
+	std::atomic<uint64_t> m_pushes{ 0 };
+	std::atomic<size_t> m_sleeping{ 0 };
+	std::atomic<bool> m_failed{ false };
+	std::mutex m_idle;		// sleeping, waking and the first error
+	std::condition_variable m_idle_cv;
+	std::exception_ptr m_error;
+};
+
+// an immutable document laid out in one block, made by basic_json<>::freeze()
+// readers on any number of threads need no synchronization, copying the handle is a single atomic
+// increment and walking the document touches no reference counts
+class frozen_json
+{
+	// 16 bytes, children of a container are adjacent, an object stores key and value node per member
+	struct node {
+		json_type type;
+		uint32_t size;		// elements, members or chars, for a number the chars of its literal or 0
+		union {
+			bool boolean;
+			double number;	// when no literal is kept
+			size_t offset;	// first child node, or first char in the block
+		};
+	};
+
+	struct header {
+		std::atomic<size_t> refs;
+		size_t nodes;
+		size_t chars;
+	};
+
+public:
+	// read-only view of a node, valid while a handle of its document is alive
+	class view
+	{
+	public:
+		json_type get_type() const noexcept { return m_node->type; }
+		bool is_null()   const noexcept { return m_node->type == json_type::null; }
+		bool is_bool()   const noexcept { return m_node->type == json_type::boolean; }
+		bool is_number() const noexcept { return m_node->type == json_type::number; }
+		bool is_string() const noexcept { return m_node->type == json_type::string; }
+		bool is_array()  const noexcept { return m_node->type == json_type::array; }
+		bool is_object() const noexcept { return m_node->type == json_type::object; }
+
+		// throw std::bad_variant_access on a type mismatch, like basic_json
+		bool   get_bool()   const { _check(json_type::boolean); return m_node->boolean; }
+		double get_number() const {
+			_check(json_type::number);
+			if (m_node->size == 0) return m_node->number;
+			return literal_to_double(m_block + m_node->offset, m_block + m_node->offset + m_node->size);
+		}
+		// the literal of a number frozen from an exact number type such as json_raw or json_decimal, empty otherwise
+		std::string_view get_literal() const {
+			_check(json_type::number);
+			return m_node->size ? std::string_view(m_block + m_node->offset, m_node->size) : std::string_view();
+		}
+		int    get_int()    const { return static_cast<int>(get_number()); }
+		std::string_view get_string() const {
+			_check(json_type::string);
+			return { m_block + m_node->offset, m_node->size };
+		}
+
+		// elements of an array, members of an object
+		size_t size() const noexcept { return is_array() || is_object() ? m_node->size : 0; }
+
+		// range checked like basic_json, throws std::out_of_range
+		view operator[](size_t idx) const {
+			_check(json_type::array);
+			if (idx >= m_node->size) throw std::out_of_range("index out of range");
+			return { m_block, _children() + idx };
+		}
+
+		// the key must exist, throws std::out_of_range
+		view operator[](std::string_view key) const {
+			view v = find(key);
+			if (!v) throw std::out_of_range("key does not exist");
+			return v;
+		}
+
+		// binary search, members are sorted by key, return an empty view if the key does not exist
+		view find(std::string_view key) const {
+			_check(json_type::object);
+			const node* first = _children();
+			size_t lo = 0, hi = m_node->size;
+			while (lo < hi) {
+				size_t mid = (lo + hi) / 2;
+				int c = _key(first + mid * 2).compare(key);
+				if (c == 0) return { m_block, first + mid * 2 + 1 };
+				if (c < 0) lo = mid + 1;
+				else hi = mid;
+			}
+			return {};
+		}
+
+		// the idx-th member of an object, in key order
+		std::string_view key(size_t idx) const { return _key(_member(idx)); }
+		view value(size_t idx) const { return { m_block, _member(idx) + 1 }; }
+
+		explicit operator bool() const noexcept { return m_node != nullptr; }
+
+	private:
+		friend class frozen_json;
+		view() = default;
+		view(const char* block, const node* n) : m_block(block), m_node(n) {}
+
+		void _check(json_type t) const { if (m_node->type != t) throw std::bad_variant_access(); }
+		const node* _children() const {
+			return reinterpret_cast<const node*>(m_block + sizeof(header)) + m_node->offset;
+		}
+		const node* _member(size_t idx) const {
+			_check(json_type::object);
+			if (idx >= m_node->size) throw std::out_of_range("index out of range");
+			return _children() + idx * 2;
+		}
+		std::string_view _key(const node* n) const { return { m_block + n->offset, n->size }; }
+
+		const char* m_block = nullptr;
+		const node* m_node = nullptr;
+	};
+
+	frozen_json() = default;
+	frozen_json(const frozen_json& other) noexcept : m_block(other.m_block) {
+		if (m_block) _header()->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+	frozen_json(frozen_json&& other) noexcept : m_block(std::exchange(other.m_block, nullptr)) {}
+	frozen_json& operator=(frozen_json other) noexcept {
+		std::swap(m_block, other.m_block);
+		return *this;
+	}
+	~frozen_json() {
+		if (m_block && _header()->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			_header()->~header();
+			::operator delete(m_block);
+		}
+	}
+
+	// the root of the document, must not be empty()
+	view root() const noexcept { return { m_block, _nodes() }; }
+	bool empty() const noexcept { return m_block == nullptr; }
+
+	// bytes taken by the whole document
+	size_t memory_size() const noexcept { return m_block ? _strings() - m_block + _header()->chars : 0; }
+
+private:
+	template<class Traits>
+	friend class basic_json;
+
+	header* _header() const { return reinterpret_cast<header*>(m_block); }
+	node* _nodes() const { return reinterpret_cast<node*>(m_block + sizeof(header)); }
+	char* _strings() const { return reinterpret_cast<char*>(_nodes() + _header()->nodes); }
+
+	// one block for the header, then all nodes, then all chars
+	frozen_json(size_t nodes, size_t chars) {
+		m_block = static_cast<char*>(::operator new(sizeof(header) + nodes * sizeof(node) + chars));
+		new(m_block) header{ {1}, nodes, chars };
+	}
+
+	static void _set_size(node& n, size_t size) {
+		if (size > UINT32_MAX) throw std::length_error("too large to freeze");
+		n.size = uint32_t(size);
+	}
+
+	// copy str into the char area at pos, which advances, and point n at it
+	void _set_string(node& n, const char* str, size_t len, size_t& pos) {
+		n.type = json_type::string;
+		_set_size(n, len);
+		char* out = _strings() + pos;
+		memcpy(out, str, len);
+		out[len] = '\0';
+		n.offset = out - m_block;
+		pos += len + 1;
+	}
+
+	char* m_block = nullptr;
+};
+
+// how basic_json parses, dumps and converts a Traits::number_type that is not arithmetic
+// a specialization provides
+//   static Number parse(const char* first, const char* last);	// [first, last) is a valid json number
+//   static void dump(writer* wr, const Number& num);
+//   static double to_double(const Number& num);
+template<class Number>
+struct number_interface;
+
+// a number kept as its json literal, converted each time it is read and dumped byte for byte,
+// so parsing skips the conversion and numbers beyond double precision survive a round trip
+// literals of up to 32 characters are packed in place at four bits a character, longer ones are allocated
+class raw_number
+{
+public:
+	static constexpr size_t INLINE_SIZE = 32;
+
+	raw_number() : raw_number("0", 1) {}
+	raw_number(int v) { _from_chars_result(v); }
+	raw_number(long long v) { _from_chars_result(v); }
+	// the shortest literal that reads back as v, throws std::invalid_argument for NaN and infinity
+	raw_number(double v) {
+		if (!std::isfinite(v)) throw std::invalid_argument("json has no NaN or Infinity");
+		_from_chars_result(v);
+	}
+	// [first, last) must be a valid json number
+	raw_number(const char* first, size_t n) { _assign(first, n); }
+
+	raw_number(const raw_number& other) {
+		if (other._is_heap()) {
+			char* p = new char[other.size()];
+			memcpy(p, other._heap_ptr(), other.size());
+			_set_heap(p, other.size());
+		}
+		else memcpy(m_bytes, other.m_bytes, sizeof(m_bytes));
+	}
+	raw_number(raw_number&& other) noexcept {
+		memcpy(m_bytes, other.m_bytes, sizeof(m_bytes));
+		other.m_bytes[0] = _encode('0');
+		other.m_bytes[HEAP_FLAG] = 0;
+	}
+	raw_number& operator=(raw_number other) noexcept {
+		std::swap(m_bytes, other.m_bytes);
+		return *this;
+	}
+	~raw_number() {
+		if (_is_heap()) delete[] _heap_ptr();
+	}
+
+	// length of the literal
+	size_t size() const noexcept {
+		if (_is_heap()) {
+			uint32_t n;
+			memcpy(&n, m_bytes + sizeof(char*), sizeof(n));
+			return n;
+		}
+		size_t n = 0;
+		while (n < INLINE_SIZE && (m_bytes[n / 2] >> (n % 2 * 4) & 0xF)) n++;
+		return n;
+	}
+
+	// copy the literal to out, which has room for size() chars, and return the end of it
+	char* copy(char* out) const noexcept {
+		if (_is_heap()) {
+			size_t n = size();
+			memcpy(out, _heap_ptr(), n);
+			return out + n;
+		}
+		for (size_t i = 0; i < INLINE_SIZE; i++) {
+			unsigned code = m_bytes[i / 2] >> (i % 2 * 4) & 0xF;
+			if (!code) break;
+			*out++ = "?0123456789-+.eE"[code];
+		}
+		return out;
+	}
+
+	std::string str() const {
+		std::string s(size(), '\0');
+		copy(s.data());
+		return s;
+	}
+
+	// correctly rounded, out of range literals become +-inf or +-0
+	operator double() const {
+		if (_is_heap()) return literal_to_double(_heap_ptr(), _heap_ptr() + size());
+		char buf[INLINE_SIZE];
+		return literal_to_double(buf, copy(buf));
+	}
+	// exact for integer literals in range, anything else is converted through double and saturates
+	explicit operator int() const { return _to_integer<int>(); }
+	explicit operator long long() const { return _to_integer<long long>(); }
+
+private:
+	static constexpr size_t HEAP_FLAG = 15;	// this byte is 0xFF for allocated literals, "EE" is never packed
+
+	static unsigned char _encode(char ch) {
+		if (is_digit(ch)) return static_cast<unsigned char>(ch - '0' + 1);
+		switch (ch) {
+		case '-': return 11;
+		case '+': return 12;
+		case '.': return 13;
+		case 'e': return 14;
+		default:  return 15;	// 'E'
+		}
+	}
+
+	void _assign(const char* first, size_t n) {
+		if (n <= INLINE_SIZE) return _pack(first, n);
+		char* p = new char[n];
+		memcpy(p, first, n);
+		_set_heap(p, n);
+	}
+
+	void _pack(const char* first, size_t n) {
+		memset(m_bytes, 0, sizeof(m_bytes));
+		for (size_t i = 0; i < n; i++) {
+			m_bytes[i / 2] |= _encode(first[i]) << (i % 2 * 4);
+		}
+	}
+
+	// shortest round trip output of double and long long is at most 24 characters
+	template<class T>
+	void _from_chars_result(T v) {
+		char buf[INLINE_SIZE];
+		auto res = std::to_chars(buf, buf + sizeof(buf), v);
+		_pack(buf, res.ptr - buf);
+	}
+
+	template<class T>
+	T _to_integer() const {
+		char buf[INLINE_SIZE];
+		const char* first = _is_heap() ? _heap_ptr() : buf;
+		const char* last = _is_heap() ? first + size() : copy(buf);
+		return literal_to<T>(first, last);
+	}
+
+	bool _is_heap() const noexcept { return m_bytes[HEAP_FLAG] == 0xFF; }
+
+	char* _heap_ptr() const noexcept {
+		char* p;
+		memcpy(&p, m_bytes, sizeof(p));
+		return p;
+	}
+
+	void _set_heap(char* p, size_t n) {
+		if (n > UINT32_MAX) {
+			delete[] p;
+			throw std::length_error("number literal too long");
+		}
+		uint32_t n32 = uint32_t(n);
+		memcpy(m_bytes, &p, sizeof(p));
+		memcpy(m_bytes + sizeof(p), &n32, sizeof(n32));
+		m_bytes[HEAP_FLAG] = 0xFF;
+	}
+
+	alignas(8) unsigned char m_bytes[16];
+};
+
+template<>
+struct number_interface<raw_number> {
+	static raw_number parse(const char* first, const char* last) { return raw_number(first, last - first); }
+
+	static void dump(writer* wr, const raw_number& num) {
+		if (num.size() > raw_number::INLINE_SIZE) {
+			std::string s = num.str();
+			return wr->write(s.data(), s.size());
+		}
+		char buf[raw_number::INLINE_SIZE];
+		wr->write(buf, num.copy(buf) - buf);
+	}
+
+	static double to_double(const raw_number& num) { return num; }
+};
+
+// numbers are parsed as raw_number, see above
+struct json_raw_traits : json_traits {
+	using number_type = raw_number;
+};
+
+// an exact decimal number, coefficient * 10^exponent, for values such as prices that must not be rounded
+// the value and its digits are kept, trailing zeros included, 1.50 is (150, -2) and dumps as 1.50,
+// but not the notation of the literal, 1.5e-10 dumps as 15e-11 and 1.50e3 as 150e1, see _format()
+// coefficients beyond 18 digits or exponents beyond int32 fall back to an allocated digit string
+class decimal
+{
+public:
+	// room for the literal of any decimal that is not is_big()
+	static constexpr size_t MAX_SIZE = 40;
+
+	decimal() = default;
+	decimal(int v) : m_coef(v) {}
+	decimal(long long v) : m_coef(v) {}
+	// exponent must not be INT_MIN
+	decimal(long long coefficient, int exponent) : m_coef(coefficient), m_exp(exponent) {}
+	// the shortest decimal that reads back as v, throws std::invalid_argument for NaN and infinity
+	decimal(double v) {
+		if (!std::isfinite(v)) throw std::invalid_argument("json has no NaN or Infinity");
+		char buf[32];
+		auto res = std::to_chars(buf, buf + sizeof(buf), v);
+		_assign(buf, res.ptr);
+	}
+	// [first, last) must be a valid json number
+	decimal(const char* first, const char* last) { _assign(first, last); }
+
+	// m_coef and m_big share storage, only the one is_big() selects is read
+	decimal(const decimal& other) : m_exp(other.m_exp), m_neg_zero(other.m_neg_zero) {
+		if (other.is_big()) m_big = new big(*other.m_big);
+		else m_coef = other.m_coef;
+	}
+	decimal(decimal&& other) noexcept : m_exp(other.m_exp), m_neg_zero(other.m_neg_zero) {
+		if (other.is_big()) m_big = other.m_big;
+		else m_coef = other.m_coef;
+		other.m_coef = 0;
+		other.m_exp = 0;
+		other.m_neg_zero = false;
+	}
+	decimal& operator=(decimal other) noexcept {
+		this->~decimal();
+		return *new(this) decimal(std::move(other));
+	}
+	~decimal() {
+		if (is_big()) delete m_big;
+	}
+
+	// the coefficient and exponent are only meaningful if !is_big()
+	bool is_big() const noexcept { return m_exp == BIG; }
+	long long coefficient() const noexcept { return m_coef; }
+	int exponent() const noexcept { return m_exp; }
+
+	// write the exact json literal to out, which has room for MAX_SIZE chars, and return the end of it
+	// only for !is_big(), see str()
+	char* to_chars(char* out) const noexcept {
+		char digits[24];
+		unsigned long long mag = m_coef < 0 ? 0 - (unsigned long long)m_coef : m_coef;
+		auto res = std::to_chars(digits, digits + sizeof(digits), mag);
+		return _format(out, m_coef < 0 || m_neg_zero, digits, res.ptr - digits, m_exp);
+	}
+
+	// the exact json literal
+	std::string str() const {
+		if (!is_big()) {
+			char buf[MAX_SIZE];
+			return std::string(buf, to_chars(buf));
+		}
+		const std::string& digits = m_big->digits;
+		std::string s(digits.size() + 32, '\0');
+		s.erase(_format(s.data(), m_big->neg, digits.data(), digits.size(), m_big->exponent) - s.data());
+		return s;
+	}
+
+	// correctly rounded
+	operator double() const {
+		if (is_big()) {
+			std::string s = str();
+			return literal_to_double(s.data(), s.data() + s.size());
+		}
+		if (m_exp == 0 && !m_neg_zero) return double(m_coef);
+		char buf[MAX_SIZE];
+		return literal_to_double(buf, to_chars(buf));
+	}
+	// truncated toward zero, exact while it fits, saturated otherwise
+	explicit operator int() const { return static_cast<int>(std::clamp<long long>(static_cast<long long>(*this), INT_MIN, INT_MAX)); }
+	explicit operator long long() const {
+		if (is_big()) return _saturate<long long>(double(*this));
+		long long v = m_coef;
+		if (m_exp < 0) {
+			for (int i = 0; i < -m_exp && v; i++) v /= 10;
+			return v;
+		}
+		for (int i = 0; i < m_exp; i++) {
+			if (v > LLONG_MAX / 10 || v < LLONG_MIN / 10) return _saturate<long long>(double(*this));
+			v *= 10;
+		}
+		return v;
+	}
+
+private:
+	static constexpr int BIG = INT_MIN;
+
+	struct big {
+		bool neg;
+		std::string digits;		// without leading zeros, "0" for zero
+		long long exponent;
+	};
+
+	void _assign(const char* first, const char* last) {
+		const char* literal = first;
+		bool neg = *first == '-';
+		if (neg) ++first;
+		// the decimal point only moves the exponent, leading zeros are dropped
+		unsigned long long coef = 0;
+		int n = 0;
+		long long expo = 0;
+		for (; first != last && is_digit(*first); ++first) {
+			if (n || *first != '0') coef = coef * 10 + (*first - '0'), n++;
+			if (n > 18) return _assign_big(literal, last);
+		}
+		if (first != last && *first == '.') {
+			for (++first; first != last && is_digit(*first); ++first) {
+				if (n || *first != '0') coef = coef * 10 + (*first - '0'), n++;
+				if (n > 18) return _assign_big(literal, last);
+				expo--;
+			}
+		}
+		if (first != last) {
+			expo += _read_exponent(first, last);
+			if (expo <= BIG || expo > INT_MAX) return _assign_big(literal, last);
+		}
+		m_coef = neg ? -(long long)coef : (long long)coef;
+		m_exp = int(expo);
+		m_neg_zero = neg && !coef;
+	}
+
+	// the same walk as _assign(), collecting any number of digits
+	void _assign_big(const char* first, const char* last) {
+		auto b = std::make_unique<big>();
+		b->neg = *first == '-';
+		if (b->neg) ++first;
+		b->exponent = 0;
+		for (; first != last && is_digit(*first); ++first) {
+			if (!b->digits.empty() || *first != '0') b->digits += *first;
+		}
+		if (first != last && *first == '.') {
+			for (++first; first != last && is_digit(*first); ++first) {
+				if (!b->digits.empty() || *first != '0') b->digits += *first;
+				b->exponent--;
+			}
+		}
+		if (first != last) b->exponent += _read_exponent(first, last);
+		if (b->digits.empty()) b->digits = "0";
+		m_big = b.release();
+		m_exp = BIG;
+	}
+
+	// first points at 'e' or 'E'
+	static long long _read_exponent(const char* first, const char* last) {
+		bool neg = *++first == '-';
+		if (*first == '+' || *first == '-') ++first;
+		long long e = 0;
+		for (; first != last && is_digit(*first); ++first) {
+			// saturate, no decimal of interest has an exponent near this
+			if (e < (1ll << 58)) e = e * 10 + (*first - '0');
+		}
+		return neg ? -e : e;
+	}
+
+	// plain notation unless that needs more than 6 leading zeros or any trailing ones
+	// out has room for n + 32 chars
+	static char* _format(char* out, bool neg, const char* digits, size_t n, long long expo) {
+		if (neg) *out++ = '-';
+		long long point = (long long)n + expo;	// digits before the decimal point
+		if (expo > 0 || point < -6) {
+			out = std::copy(digits, digits + n, out);
+			*out++ = 'e';
+			return std::to_chars(out, out + 24, expo).ptr;
+		}
+		if (expo == 0) return std::copy(digits, digits + n, out);
+		if (point <= 0) {
+			*out++ = '0';
+			*out++ = '.';
+			out = std::fill_n(out, -point, '0');
+			return std::copy(digits, digits + n, out);
+		}
+		out = std::copy(digits, digits + point, out);
+		*out++ = '.';
+		return std::copy(digits + point, digits + n, out);
+	}
+
+	union {
+		long long m_coef = 0;
+		big* m_big;
+	};
+	int m_exp = 0;
+	bool m_neg_zero = false;	// "-0", "-0.0" and the like, the sign a zero coefficient cannot carry
+};
+
+template<>
+struct number_interface<decimal> {
+	static decimal parse(const char* first, const char* last) { return decimal(first, last); }
+
+	static void dump(writer* wr, const decimal& num) {
+		if (num.is_big()) {
+			std::string s = num.str();
+			return wr->write(s.data(), s.size());
+		}
+		char buf[decimal::MAX_SIZE];
+		wr->write(buf, num.to_chars(buf) - buf);
+	}
+
+	static double to_double(const decimal& num) { return num; }
+};
+
+// numbers are parsed as decimal, see above
+struct json_decimal_traits : json_traits {
+	using number_type = decimal;
+};
+
+template<class Traits, class = void>
+struct _packs_numeric_arrays : std::false_type {};
+template<class Traits>
+struct _packs_numeric_arrays<Traits, std::void_t<decltype(Traits::pack_numeric_arrays)>>
+	: std::bool_constant<Traits::pack_numeric_arrays> {};
+
+
+template<class Traits = json_traits>
+class basic_json
+{
+public:
+	using number = typename Traits::number_type;
+	using string = typename Traits::string_type;
+	using array  = typename Traits::template array_type<basic_json>;
+	using object = typename Traits::template map_type<string, basic_json>;
+
+	template<class T>
+	using smart_ptr = typename Traits::template smart_pointer_type<T>;
+
+	// make sure make_smart<> is consistent with smart_pointer_type<>
+	static_assert(std::is_same_v<smart_ptr<int>, decltype(Traits::template make_smart<int>())>);
+
+	using sptr_string_t = smart_ptr<string>; // should be not-null
+	using sptr_array_t  = smart_ptr<array>;  // should be not-null
+	using sptr_object_t = smart_ptr<object>; // should be not-null
+
+	// a numbers-only array, only held if Traits::pack_numeric_arrays, as the last alternative of variant_t
+	using packed_array  = typename Traits::template array_type<number>;
+	using sptr_packed_t = smart_ptr<packed_array>;
+	static constexpr bool PACKED = _packs_numeric_arrays<Traits>::value;
+
+	using variant_t = std::conditional_t<PACKED,
+		std::variant<std::nullptr_t, bool, number, sptr_string_t, sptr_array_t, sptr_object_t, sptr_packed_t>,
+		std::variant<std::nullptr_t, bool, number, sptr_string_t, sptr_array_t, sptr_object_t>>;
+
+private:
+	variant_t m_var;
+
+	template<class T, class... Args>
+	static smart_ptr<T> _make_smart(Args&&... args) {
+		return Traits::template make_smart<T>(std::forward<Args>(args)...);
+	}
+
+public:
+	basic_json() = default;
+	basic_json(std::nullptr_t)  : m_var(nullptr) {}
+	basic_json(bool v)          : m_var(v) {}
+	basic_json(number v)        : m_var(v) {}
+	basic_json(int v)           : m_var(number(v)) {}
+	template<class N = number, class = std::enable_if_t<!std::is_same_v<N, double>>>
+	basic_json(double v)        : m_var(number(v)) {}
+	basic_json(const string& v) : m_var(_make_smart<string>(v)) {}
+	basic_json(string&& v)      : m_var(_make_smart<string>(std::move(v))) {}
+	basic_json(const char* v)   : m_var(_make_smart<string>(v)) {}
+	basic_json(const array& v)  : m_var(_make_smart<array>(v)) {}
+	basic_json(array&& v)       : m_var(_make_smart<array>(std::move(v))) {}
+	basic_json(const object& v) : m_var(_make_smart<object>(v)) {}
+	basic_json(object&& v)      : m_var(_make_smart<object>(std::move(v))) {}
+
+	// construct the string, array or object directly from args, e.g.
+	// json(std::in_place_type<json::string>, 1024, ' ') or json(std::in_place_type<json::array>, first, last)
+	template<class T, class... Args, class = std::enable_if_t<
+		std::is_same_v<T, string> || std::is_same_v<T, array> || std::is_same_v<T, object>>>
+	explicit basic_json(std::in_place_type_t<T>, Args&&... args) : m_var(_make_smart<T>(std::forward<Args>(args)...)) {}
+
+	// an array of exactly sizeof...(Args) elements, each constructed from its argument
+	// unlike json::array{ ... }, which copies out of an initializer_list, rvalues are moved
+	template<class... Args>
+	static basic_json make_array(Args&&... args) {
+		basic_json j(std::in_place_type<array>);
+		auto& arr = j._array();
+		arr.reserve(sizeof...(Args));
+		(arr.emplace_back(std::forward<Args>(args)), ...);
+		return j;
+	}
+
+	basic_json(basic_json&&) = default;
+	basic_json& operator=(basic_json&&) = default;
+
+	// shallow trees are freed recursively, below 32 levels the rest is freed with a loop,
+	// so deep documents cannot overflow the stack
+	~basic_json() {
+		if (m_var.index() < 4) return;
+		static thread_local int depth = 0;
+		if (depth >= 32) {
+			_release_children();
+			return;
+		}
+		++depth;
+		m_var = nullptr;
+		--depth;
+	}
+
+	// make a deep copy even if using shared pointer
+	basic_json& operator=(const basic_json& other) {
+		// TODO use std::visit
+		switch (other.m_var.index()) {
+		case 0: m_var = nullptr; break;
+		case 1: m_var = other.get_bool(); break;
+		case 2: m_var = other.get_number(); break;
+		case 3: m_var = _make_smart<string>(other.get_string()); break;
+		case 4: m_var = _make_smart<array>(other._array()); break;
+		case 5: m_var = _make_smart<object>(other.get_object()); break;
+		default:
+			if constexpr (PACKED) m_var = _make_smart<packed_array>(other.get_packed());
+			break;
+		}
+		return *this;
+	}
+	basic_json(const basic_json& other) { operator=(other); }
+
+	// same as the copy constructor
+	basic_json deep_copy() const { return *this; }
+
+	// copy on policy.threads threads, trees smaller than policy.grain nodes are copied on this thread
+	basic_json deep_copy(const parallel_policy& policy) const {
+		size_t grain = std::max<size_t>(policy.grain, 1);
+		if (policy.threads <= 1 || _count_nodes(grain) < grain) return *this;
+		basic_json out;
+		_task_pool pool(policy.threads);
+		pool.push([&] { _parallel_copy(pool, *this, out, grain); });
+		pool.run();
+		return out;
+	}
+
+	variant_t&       get_variant()       noexcept { return m_var; }
+	const variant_t& get_variant() const noexcept { return m_var; }
+
+	json_type get_type() const noexcept { return is_packed() ? json_type::array : (json_type)m_var.index(); }
+	bool is_null()   const noexcept { return m_var.index() == 0; }
+	bool is_bool()   const noexcept { return m_var.index() == 1; }
+	bool is_number() const noexcept { return m_var.index() == 2; }
+	bool is_string() const noexcept { return m_var.index() == 3; }
+	bool is_array()  const noexcept { return m_var.index() == 4 || is_packed(); }
+	bool is_object() const noexcept { return m_var.index() == 5; }
+	bool is_packed() const noexcept { return PACKED && m_var.index() == 6; }
+
+	// json_packed hands out array elements through these, so that a packed array is neither copied
+	// nor unpacked to be read, other traits use plain references, see the definitions below the class
+	template<class E> class _element_reads;
+	class _const_element;
+	class _element;
+	template<bool Const> class _array_view;
+
+	using const_element    = std::conditional_t<PACKED, _const_element, const basic_json&>;
+	using element          = std::conditional_t<PACKED, _element, basic_json&>;
+	using const_array_view = std::conditional_t<PACKED, _array_view<true>, const array&>;
+	using array_view       = std::conditional_t<PACKED, _array_view<false>, array&>;
+
+	bool&      get_bool()   { return std::get<bool>(m_var); }
+	number&    get_number() { return std::get<number>(m_var); }
+	string&    get_string() { return *std::get<sptr_string_t>(m_var); }
+	array_view get_array()  { if constexpr (PACKED) return array_view(this); else return _array(); }
+	object&    get_object() { return *std::get<sptr_object_t>(m_var); }
+
+	bool             get_bool()   const { return std::get<bool>(m_var); }
+	number           get_number() const { return std::get<number>(m_var); }
+	int              get_int()    const { return static_cast<int>(get_number()); }
+	const string&    get_string() const { return *std::get<sptr_string_t>(m_var); }
+	const_array_view get_array()  const { if constexpr (PACKED) return const_array_view(this); else return _array(); }
+	const object&    get_object() const { return *std::get<sptr_object_t>(m_var); }
+
+	// the numbers of a packed array, modifying them keeps it packed
+	// get_array() reads and writes either form, only storing something other than a number unpacks
+	packed_array&       get_packed()       { return *std::get<sptr_packed_t>(m_var); }
+	const packed_array& get_packed() const { return *std::get<sptr_packed_t>(m_var); }
+
+	// convert the numbers of an array into out[0, n), stopping at the end of either, return the count
+	// an element that is not a number throws std::bad_variant_access, like get_number()
+	template<class T>
+	size_t copy_to(T* out, size_t n) const {
+		static_assert(std::is_arithmetic_v<T>);
+		if (auto* nums = ptr_packed()) {
+			n = std::min(n, nums->size());
+			for (size_t i = 0; i < n; i++) out[i] = static_cast<T>((*nums)[i]);
+			return n;
+		}
+		auto& arr = _array();
+		n = std::min(n, arr.size());
+		for (size_t i = 0; i < n; i++) out[i] = static_cast<T>(arr[i].get_number());
+		return n;
+	}
+
+	// out is anything contiguous with data() and size(), e.g. std::vector<float> or std::span<double>
+	template<class Range, class = decltype(std::declval<Range&>().data())>
+	size_t copy_to(Range&& out) const { return copy_to(out.data(), out.size()); }
+
+	// the numbers of an array as a std::vector<T>, see copy_to()
+	template<class T = double>
+	std::vector<T> as_vector() const {
+		auto* nums = ptr_packed();
+		std::vector<T> v(nums ? nums->size() : _array().size());
+		copy_to(v.data(), v.size());
+		return v;
+	}
+
+	// turn a packed array into an array of basic_json, does nothing to anything else
+	void unpack() {
+		if constexpr (PACKED) {
+			if (!is_packed()) return;
+			auto arr = _make_smart<array>();
+			auto& nums = get_packed();
+			arr->reserve(nums.size());
+			for (auto& n : nums) arr->emplace_back(std::move(n));
+			m_var = std::move(arr);
+		}
+	}
+
+	string& set_string() { m_var = _make_smart<string>();  return get_string(); }
+	array&  set_array()  { m_var = _make_smart<array>();  return _array(); }
+	object& set_object() { m_var = _make_smart<object>();  return get_object(); }
+
+	// auto expand if idx >= get_array().size(), or create one if is_null()
+	// throws if *this is not null nor an array
+	// for json_packed expanding a packed array unpacks it, the null elements added are not numbers
+	element operator[](size_t idx) {
+		if (is_null()) m_var = _make_smart<array>(idx + 1);
+		if constexpr (PACKED) {
+			auto* nums = ptr_packed();
+			if (nums && idx < nums->size()) return element(this, idx);
+			unpack();
+		}
+		auto& arr = _array();
+		if (arr.size() <= idx) arr.resize(idx + 1);
+		if constexpr (PACKED) return element(this, idx);
+		else return arr[idx];
+	}
+
+	// array is immutable, must be array and does range check
+	const_element operator[](size_t idx) const {
+		if constexpr (PACKED) {
+			if (auto* nums = ptr_packed()) return const_element(nums->at(idx));
+			return const_element(&_array().at(idx));
+		}
+		else return _array().at(idx);
+	}
+
+	// auto fill null if desired key does not exist, or create one if is_null()
+	// throws if *this is not null nor an object
+	basic_json& operator[](const string& key) {
+		if (is_null()) m_var = _make_smart<object>();
+		return get_object()[key];
+	}
+
+	basic_json& operator[](string&& key) {
+		if (is_null()) m_var = _make_smart<object>();
+		return get_object()[std::move(key)];
+	}
+
+	// object is immutable, the key must exist
+	const basic_json& operator[](const string& key) const {
+		auto& obj = get_object();
+		auto it = obj.find(key);
+		if (it == obj.end()) throw std::out_of_range("key does not exist");
+		return it->second;
+	}
+
+	// the lookups below take a std::string_view or a c-string and build no string if object::find()
+	// accepts them, which the std::map of the default traits does, and json_unordered from C++20 on
+	// all but contains() and the non-const operator[] throw if *this is not an object
+
+	// same as operator[](const string&), the string is only built to insert a missing key
+	basic_json& operator[](std::string_view key) {
+		if (is_null()) m_var = _make_smart<object>();
+		auto& obj = get_object();
+		auto it = _find(obj, key);
+		if (it != obj.end()) return it->second;
+		return obj.emplace(string(key.data(), key.size()), nullptr).first->second;
+	}
+
+	const basic_json& operator[](std::string_view key) const { return at(key); }
+
+	// a template so that j[0] still means the array index
+	template<class Char, class = std::enable_if_t<std::is_same_v<std::remove_const_t<Char>, char>>>
+	basic_json& operator[](Char* key) { return operator[](std::string_view(key)); }
+
+	template<class Char, class = std::enable_if_t<std::is_same_v<std::remove_const_t<Char>, char>>>
+	const basic_json& operator[](Char* key) const { return at(key); }
+
+	// throws std::out_of_range if the key does not exist
+	basic_json& at(std::string_view key) {
+		basic_json* j = find(key);
+		if (!j) throw std::out_of_range("key does not exist");
+		return *j;
+	}
+
+	const basic_json& at(std::string_view key) const {
+		const basic_json* j = find(key);
+		if (!j) throw std::out_of_range("key does not exist");
+		return *j;
+	}
+
+	// nullptr if the key does not exist
+	basic_json* find(std::string_view key) {
+		auto& obj = get_object();
+		auto it = _find(obj, key);
+		return it != obj.end() ? &it->second : nullptr;
+	}
+
+	const basic_json* find(std::string_view key) const {
+		auto& obj = get_object();
+		auto it = _find(obj, key);
+		return it != obj.end() ? &it->second : nullptr;
+	}
+
+	// false for anything but an object with the key
+	bool contains(std::string_view key) const { return is_object() && find(key); }
+
+	// the same lookups by a json17::key
+	basic_json& operator[](const key& k) {
+		if (is_null()) m_var = _make_smart<object>();
+		auto& obj = get_object();
+		auto it = _find(obj, k);
+		if (it != obj.end()) return it->second;
+		return obj.emplace(string(k.str().data(), k.size()), nullptr).first->second;
+	}
+
+	const basic_json& operator[](const key& k) const { return at(k); }
+
+	basic_json& at(const key& k) {
+		basic_json* j = find(k);
+		if (!j) throw std::out_of_range("key does not exist");
+		return *j;
+	}
+
+	const basic_json& at(const key& k) const {
+		const basic_json* j = find(k);
+		if (!j) throw std::out_of_range("key does not exist");
+		return *j;
+	}
+
+	basic_json* find(const key& k) {
+		auto& obj = get_object();
+		auto it = _find(obj, k);
+		return it != obj.end() ? &it->second : nullptr;
+	}
+
+	const basic_json* find(const key& k) const {
+		auto& obj = get_object();
+		auto it = _find(obj, k);
+		return it != obj.end() ? &it->second : nullptr;
+	}
+
+	bool contains(const key& k) const { return is_object() && find(k); }
+
+	// construct a new element at the end in place, create an array if is_null()
+	// throws if *this is not null nor an array
+	template<class... Args>
+	element emplace_back(Args&&... args) {
+		if (is_null()) m_var = _make_smart<array>();
+		return get_array().emplace_back(std::forward<Args>(args)...);
+	}
+
+	// same as object::emplace() and object::try_emplace(), create an object if is_null()
+	// throws if *this is not null nor an object
+	template<class K, class... Args>
+	auto emplace(K&& key, Args&&... args) {
+		if (is_null()) m_var = _make_smart<object>();
+		return get_object().emplace(std::piecewise_construct,
+			std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+	}
+
+	template<class K, class... Args>
+	auto try_emplace(K&& key, Args&&... args) {
+		if (is_null()) m_var = _make_smart<object>();
+		return get_object().try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+	}
+
+	bool*   ptr_bool()   noexcept { return std::get_if<bool>(&m_var); }
+	number* ptr_number() noexcept { return std::get_if<number>(&m_var); }
+	string* ptr_string() noexcept { auto* ptr = std::get_if<sptr_string_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+	object* ptr_object() noexcept { auto* ptr = std::get_if<sptr_object_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+
+	const bool*   ptr_bool()   const noexcept { return std::get_if<bool>(&m_var); }
+	const number* ptr_number() const noexcept { return std::get_if<number>(&m_var); }
+	const string* ptr_string() const noexcept { auto* ptr = std::get_if<sptr_string_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+	const object* ptr_object() const noexcept { auto* ptr = std::get_if<sptr_object_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+
+	// for json_packed an empty std::optional of the array view instead of nullptr, so that
+	// `if (auto arr = j.ptr_array()) arr->size()` works either way, and a packed array is an array too
+	using array_ptr       = std::conditional_t<PACKED, std::optional<_array_view<false>>, array*>;
+	using const_array_ptr = std::conditional_t<PACKED, std::optional<_array_view<true>>, const array*>;
+
+	array_ptr ptr_array() noexcept {
+		if constexpr (PACKED) { if (is_array()) return array_view(this);  return std::nullopt; }
+		else return _ptr_array();
+	}
+	const_array_ptr ptr_array() const noexcept {
+		if constexpr (PACKED) { if (is_array()) return const_array_view(this);  return std::nullopt; }
+		else return _ptr_array();
+	}
+
+	// the numbers of a packed array, nullptr for anything else, including an unpacked array
+	packed_array* ptr_packed() noexcept {
+		if constexpr (PACKED) { auto* ptr = std::get_if<sptr_packed_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+		else return nullptr;
+	}
+	const packed_array* ptr_packed() const noexcept {
+		if constexpr (PACKED) { auto* ptr = std::get_if<sptr_packed_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+		else return nullptr;
+	}
+
+	// return the underlying smart pointer
+	// do not set to nullptr, will lead to nullptr dereference
+	sptr_string_t& sptr_string() { return std::get<sptr_string_t>(m_var); }
+	sptr_array_t&  sptr_array()  { return std::get<sptr_array_t>(m_var); }
+	sptr_object_t& sptr_object() { return std::get<sptr_object_t>(m_var); }
+
+private:
+	// the array of basic_json, never the packed form, what get_array() and ptr_array() are without json_packed
+	array&       _array()       { return *std::get<sptr_array_t>(m_var); }
+	const array& _array() const { return *std::get<sptr_array_t>(m_var); }
+	array*       _ptr_array()       noexcept { auto* ptr = std::get_if<sptr_array_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+	const array* _ptr_array() const noexcept { auto* ptr = std::get_if<sptr_array_t>(&m_var);  return ptr ? ptr->get() : nullptr; }
+
+	template<class T>
+	smart_ptr<T> _get_moved() {
+		smart_ptr<T>* ptr = std::get_if<smart_ptr<T>>(&m_var);
+		if (!ptr) return nullptr;
+		smart_ptr<T> sptr(std::move(*ptr));
+		m_var = nullptr;
+		return sptr;
+	}
+
+public:
+	sptr_string_t get_moved_string() noexcept { return _get_moved<string>(); }
+	sptr_array_t  get_moved_array()  noexcept { return _get_moved<array>(); }
+	sptr_object_t get_moved_object() noexcept { return _get_moved<object>(); }
+
+	// if sptr_string_t is not copyable (i.e. std::unique_ptr), disable get_shared_*
+	template<class P = sptr_string_t>
+	std::enable_if_t<std::is_copy_assignable_v<P>, P> get_shared_string() const { 
+		auto* ptr = std::get_if<sptr_string_t>(&m_var);  
+		return ptr ? *ptr : nullptr; 
+	}
+
+	template<class P = sptr_array_t>
+	std::enable_if_t<std::is_copy_assignable_v<P>, P> get_shared_array() const { 
+		auto* ptr = std::get_if<sptr_array_t>(&m_var);  
+		return ptr ? *ptr : nullptr;
+	}
+
+	template<class P = sptr_object_t>
+	std::enable_if_t<std::is_copy_assignable_v<P>, P> get_shared_object() const { 
+		auto* ptr = std::get_if<sptr_object_t>(&m_var);  
+		return ptr ? *ptr : nullptr; 
+	}
+
+private:
+	// call f on each child if j owns its array or object alone, until f returns false
+	template<class F>
+	static void _each_owned_child(basic_json& j, F&& f) {
+		if (auto* p = std::get_if<sptr_array_t>(&j.m_var)) {
+			if (!p->get() || !_is_unique(*p)) return;
+			for (auto& e : *p->get()) if (!f(e)) return;
+		}
+		else if (auto* p = std::get_if<sptr_object_t>(&j.m_var)) {
+			if (!p->get() || !_is_unique(*p)) return;
+			for (auto& m : *p->get()) if (!f(m.second)) return;
+		}
+	}
+
+	static bool _has_container(basic_json& j) {
+		bool found = false;
+		_each_owned_child(j, [&](basic_json& e) { return !(found = e.m_var.index() >= 4); });
+		return found;
+	}
+
+	// move nested containers out to a stack, so each node is destroyed with its children already taken,
+	// if that stack cannot grow the rest is freed recursively as before
+	void _release_children() noexcept {
+		if (!_has_container(*this)) return;
+		// the stack is kept by the thread, nodes destroyed from the loop below have nothing left to take
+		static thread_local std::vector<basic_json> stack;
+		try {
+			auto take = [&](basic_json& e) {
+				if (e.m_var.index() >= 4) {
+					stack.push_back(std::move(e));
+					e.m_var = nullptr;
+				}
+				return true;
+			};
+			_each_owned_child(*this, take);
+			while (!stack.empty()) {
+				basic_json j = std::move(stack.back());
+				stack.pop_back();
+				_each_owned_child(j, take);
+			}
+		}
+		catch (...) {
+			stack.clear();
+		}
+	}
+
+	// nodes in this tree, each number of a packed array counts as one, counting stops at limit
+	size_t _count_nodes(size_t limit) const {
+		if (!is_array() && !is_object()) return 1;
+		size_t n = 0;
+		static thread_local std::vector<const basic_json*> todo;
+		todo.assign(1, this);
+		while (!todo.empty() && n < limit) {
+			const basic_json* j = todo.back();
+			todo.pop_back();
+			n++;
+			if (auto* nums = j->ptr_packed()) n += nums->size();
+			else if (auto* arr = j->_ptr_array()) for (auto& e : *arr) todo.push_back(&e);
+			else if (auto* obj = j->ptr_object()) for (auto& m : *obj) todo.push_back(&m.second);
+		}
+		return n;
+	}
+
+	// lay out the container and queue its children, big ones are split again,
+	// runs of small ones adding up to about grain nodes are copied by one task
+	static void _parallel_copy(_task_pool& pool, const basic_json& src, basic_json& dst, size_t grain) {
+		using item = std::pair<const basic_json*, basic_json*>;
+		auto items = std::make_shared<std::vector<item>>();
+		if (auto* arr = src._ptr_array()) {
+			auto& out = dst.set_array();
+			out.resize(arr->size());
+			items->reserve(arr->size());
+			for (size_t i = 0; i < arr->size(); i++) items->emplace_back(&(*arr)[i], &out[i]);
+		}
+		else if (auto* obj = src.ptr_object()) {
+			auto& out = dst.set_object();
+			if constexpr (_has_reserve<object>::value) out.reserve(obj->size());
+			items->reserve(obj->size());
+			for (auto& m : *obj) items->emplace_back(&m.second, &out.emplace_hint(out.end(), m.first, nullptr)->second);
+		}
+		else if (src.is_packed()) {
+			if constexpr (PACKED) {	// plain numbers, copied in runs of grain
+				auto* nums = src.ptr_packed();
+				dst.m_var = _make_smart<packed_array>(nums->size());
+				packed_array* out = &dst.get_packed();
+				for (size_t begin = 0; begin < nums->size(); begin += grain) {
+					size_t end = std::min(begin + grain, nums->size());
+					pool.push([nums, out, begin, end] { std::copy(nums->begin() + begin, nums->begin() + end, out->begin() + begin); });
+				}
+			}
+			return;
+		}
+		else {
+			dst = src;
+			return;
+		}
+
+		size_t begin = 0, weight = 0;
+		auto flush = [&](size_t end) {
+			if (begin < end) pool.push([items, begin, end] {
+				for (size_t i = begin; i < end; i++) *(*items)[i].second = *(*items)[i].first;
+			});
+			begin = end;
+			weight = 0;
+		};
+		for (size_t i = 0; i < items->size(); i++) {
+			size_t n = (*items)[i].first->_count_nodes(grain);
+			if (n >= grain) {
+				flush(i);
+				pool.push([&pool, it = (*items)[i], grain] { _parallel_copy(pool, *it.first, *it.second, grain); });
+				begin = i + 1;
+			}
+			else if ((weight += n) >= grain) flush(i + 1);
+		}
+		flush(items->size());
+	}
+
+public:
+	// copy into an immutable single-block document, see frozen_json
+	// object members are stored sorted by key so lookups can binary search
+	// numbers of a non-arithmetic number_type keep their dumped literal, see frozen_json::view::get_literal()
+	frozen_json freeze() const {
+		std::string literal;
+		auto literal_chars = [&](const number& v) -> size_t {
+			if constexpr (std::is_arithmetic_v<number>) return 0;
+			else return _number_literal(v, literal).size() + 1;
+		};
+
+		// count nodes and chars first, to allocate once
+		size_t nodes = 1, chars = 0;
+		std::vector<const basic_json*> todo{ this };
+		while (!todo.empty()) {
+			const basic_json* j = todo.back();
+			todo.pop_back();
+			switch (j->m_var.index()) {
+			case 2: chars += literal_chars(j->get_number()); break;
+			case 3: chars += j->get_string().size() + 1; break;
+			case 4:
+				nodes += j->_array().size();
+				for (auto& e : j->_array()) todo.push_back(&e);
+				break;
+			case 5:
+				nodes += j->get_object().size() * 2;
+				for (auto& m : j->get_object()) {
+					chars += m.first.size() + 1;
+					todo.push_back(&m.second);
+				}
+				break;
+			case 6:
+				nodes += j->ptr_packed()->size();
+				for (auto& v : *j->ptr_packed()) chars += literal_chars(v);
+				break;
+			}
+		}
+
+		// then fill breadth first, each container gets its children as one run of nodes
+		frozen_json doc(nodes, chars);
+		frozen_json::node* out = doc._nodes();
+		size_t next = 1, pos = 0;
+		auto set_number = [&](frozen_json::node& n, const number& v) {
+			if constexpr (std::is_arithmetic_v<number>) n.size = 0, n.number = double(v);
+			else {
+				_number_literal(v, literal);
+				doc._set_string(n, literal.data(), literal.size(), pos);
+			}
+			n.type = json_type::number;
+		};
+		std::vector<std::pair<const basic_json*, size_t>> queue{ { this, 0 } };
+		std::vector<const member*> members;
+		for (size_t q = 0; q < queue.size(); q++) {
+			const basic_json& j = *queue[q].first;
+			frozen_json::node& n = out[queue[q].second];
+			n.type = j.get_type();
+			switch (j.m_var.index()) {
+			case 0: n.size = 0, n.offset = 0; break;
+			case 1: n.size = 0, n.boolean = j.get_bool(); break;
+			case 2: set_number(n, j.get_number()); break;
+			case 3: doc._set_string(n, j.get_string().data(), j.get_string().size(), pos); break;
+			case 4: {
+				auto& arr = j._array();
+				frozen_json::_set_size(n, arr.size());
+				n.offset = next;
+				for (auto& e : arr) queue.emplace_back(&e, next++);
+				break;
+			}
+			case 5: {
+				auto& obj = j.get_object();
+				frozen_json::_set_size(n, obj.size());
+				n.offset = next;
+				members.clear();
+				for (auto& m : obj) members.push_back(&m);
+				if constexpr (!_is_byte_ordered<object>::value) {
+					std::sort(members.begin(), members.end(), [](const member* a, const member* b) {
+						return std::string_view(a->first.data(), a->first.size()) < std::string_view(b->first.data(), b->first.size());
+					});
+				}
+				for (const member* m : members) {
+					doc._set_string(out[next++], m->first.data(), m->first.size(), pos);
+					queue.emplace_back(&m->second, next++);
+				}
+				break;
+			}
+			case 6: {	// packed, the numbers are leaves and are filled right away
+				auto& nums = *j.ptr_packed();
+				frozen_json::_set_size(n, nums.size());
+				n.offset = next;
+				for (auto& v : nums) set_number(out[next++], v);
+				break;
+			}
+			}
+		}
+		return doc;
+	}
+
+private:
+	static void _dump_number(writer* wr, const number& n) {
+		if constexpr (!std::is_arithmetic_v<number>) return number_interface<number>::dump(wr, n);
+		else _dump_double(wr, n);
+	}
+
+	static void _dump_double(writer* wr, double num) {
+		if (!std::isfinite(num)) {
+			wr->write("null");
+			return;
+		}
+		// std::to_chars does not consult the locale, unlike sprintf
+		char buf[32];
+		std::to_chars_result res;
+		if (fabs(num) <= INT_MAX && int(num) == num) {
+			res = std::to_chars(buf, buf + sizeof(buf), int(num));
+		}
+		else {
+			res = std::to_chars(buf, buf + sizeof(buf), num, std::chars_format::general, 17);	 // 17 == std::numeric_limits<double>::max_digits10
+		}
+		wr->write(buf, res.ptr - buf);
+	}
+
+	// ECMAScript Number::toString, the shortest digits that round trip, in fixed notation between 1e-7 and 1e21
+	static void _dump_number_es(writer* wr, double num) {
+		if (!std::isfinite(num)) throw std::invalid_argument("canonical json has no NaN or Infinity");
+		if (num == 0) return wr->write('0');	// including -0
+
+		char sci[32];
+		auto res = std::to_chars(sci, sci + sizeof(sci), num, std::chars_format::scientific);
+		const char* p = sci;
+		char buf[48];
+		char* out = buf;
+		if (*p == '-') *out++ = *p++;
+		// split d.ddde+xx into the digits and n, the position of the decimal point
+		char digits[20];
+		int k = 0;
+		for (; *p != 'e'; p++) if (*p != '.') digits[k++] = *p;
+		int n = 0;
+		std::from_chars(p + (p[1] == '+' ? 2 : 1), res.ptr, n);
+		n += 1;
+
+		if (k <= n && n <= 21) {
+			out = std::copy(digits, digits + k, out);
+			out = std::fill_n(out, n - k, '0');
+		}
+		else if (0 < n && n <= 21) {
+			out = std::copy(digits, digits + n, out);
+			*out++ = '.';
+			out = std::copy(digits + n, digits + k, out);
+		}
+		else if (-6 < n && n <= 0) {
+			*out++ = '0';
+			*out++ = '.';
+			out = std::fill_n(out, -n, '0');
+			out = std::copy(digits, digits + k, out);
+		}
+		else {
+			*out++ = digits[0];
+			if (k > 1) {
+				*out++ = '.';
+				out = std::copy(digits + 1, digits + k, out);
+			}
+			*out++ = 'e';
+			*out++ = n - 1 < 0 ? '-' : '+';
+			out = std::to_chars(out, buf + sizeof(buf), std::abs(n - 1)).ptr;
+		}
+		wr->write(buf, out - buf);
+	}
+
+	static constexpr char HEX[] = "0123456789abcdef";
+
+	static void _write_hex4(int cp, char buf[]) {
+		// 0, 1 is '\\' 'u'
+		buf[2] = HEX[cp >> 12];
+		buf[3] = HEX[(cp >> 8) & 0x0f];
+		buf[4] = HEX[(cp >> 4) & 0x0f];
+		buf[5] = HEX[cp & 0x0f];
+	}
+
+	// write the char at str[i] escaped, i is left at the last char consumed
+	static void _dump_escaped(writer* wr, const string& str, size_t& i, bool ensure_ascii) {
+		char ch = str[i];
+		switch (ch) {
+		case '"': wr->write("\\\""); break;
+		case '\\': wr->write("\\\\"); break;
+		case '\b': wr->write("\\b"); break;
+		case '\f': wr->write("\\f"); break;
+		case '\n': wr->write("\\n"); break;
+		case '\r': wr->write("\\r"); break;
+		case '\t': wr->write("\\t"); break;
+		case '\x7f': wr->write("\\u007f"); break;
+		default:
+			uint8_t uch = ch;
+			if (uch < 0x20) {
+				char buf[] = "\\u0000";
+				buf[4] = ch < 0x10 ? '0' : '1';
+				buf[5] = HEX[ch & 0x0f];
+				wr->write(buf);
+				return;
+			}
+			if (uch < 0x80 || !ensure_ascii) {
+				wr->write(ch);
+				return;
+			}
+			
+			// ensure ascii, uch >= 0x80
+			if (uch < 0xc2 || uch > 0xf4) {
+				wr->write("\\ufffd");
+				return;
+			}
+			uint8_t uch2 = str[++i];
+			if (uch2 < 0x80 || uch2 >= 0xc0) {
+				wr->write("\\ufffd\\ufffd");
+				return;
+			}
+			char buf[] = "\\u0000";
+			int u8len = uch < 0xe0 ? 2 : uch < 0xf0 ? 3 : 4;
+			if (u8len != 4) {
+				int cp = 0;
+				if (u8len == 2) cp = (uch & 0x1f) << 6 | uch2 & 0x3f;
+				else {
+					uint8_t uch3 = str[++i];
+					if (uch3 < 0x80 || uch3 >= 0xc0) {
+						for (int ii = 0; ii < 3; ii++) wr->write("\\ufffd");
+						return;
+					}
+					cp = (uch & 0x0f) << 12 | (uch2 & 0x3f) << 6 | uch3 & 0x3f;
+				}
+				_write_hex4(cp, buf);
+				wr->write(buf);
+			}
+			else {	// 4-byte
+				uint8_t uch3 = str[++i];
+				if (uch3 < 0x80 || uch3 >= 0xc0) {
+					for (int ii = 0; ii < 3; ii++) wr->write("\\ufffd");
+					return;
+				}
+				uint8_t uch4 = str[++i];
+				int cp = (uch & 0x07) << 18 | (uch2 & 0x3f) << 12 | (uch3 & 0x3f) << 6 | uch4 & 0x3f;
+				if (uch4 < 0x80 || uch4 >= 0xc0 || cp > 0x10ffff) {
+					for (int ii = 0; ii < 4; ii++) wr->write("\\ufffd");
+					return;
+				}
+				cp -= 0x10000;
+				_write_hex4(0xD800 | cp >> 10, buf);
+				wr->write(buf);
+				_write_hex4(0xDC00 | cp & 0x3ff, buf);
+				wr->write(buf);
+			}
+		}
+	}
+
+	// canonical leaves DEL and non-ascii as they are
+	static void _dump_string(writer* wr, const string& str, const dump_options& opt) {
+		wr->write('"');
+		const char* s = str.data();
+		size_t n = str.length();
+		bool ensure_ascii = opt.ensure_ascii && !opt.canonical;
+		uint8_t del = opt.canonical ? 0 : 0x7f;
+		size_t run = 0;		// start of the chars that need no escaping, written in one go
+		for (size_t i = 0; i < n; i++) {
+			uint8_t uch = s[i];
+			if (uch >= 0x20 && uch != '"' && uch != '\\' && uch != del && (uch < 0x80 || !ensure_ascii)) continue;
+			if (run < i) wr->write_ref(s + run, i - run);
+			_dump_escaped(wr, str, i, ensure_ascii);
+			run = i + 1;
+		}
+		if (run < n) wr->write_ref(s + run, n - run);
+		wr->write('"');
+	}
+
+	using member = typename object::value_type;
+
+	// an array or object being written, with the position of the next child
+	// members of a sorted object are listed in dump_context::members from base on
+	struct dump_frame {
+		const basic_json* node;
+		size_t index;
+		typename object::const_iterator it;
+		size_t base = NOT_SORTED;
+	};
+
+	static constexpr size_t NOT_SORTED = size_t(-1);
+
+	// keys of members[first, last) are equal up to depth
+	struct sort_range {
+		size_t first, last, depth;
+	};
+
+	// buffers kept by each thread between dumps
+	struct dump_scratch {
+		std::vector<dump_frame> frames;
+		std::vector<const member*> members;
+		std::vector<const member*> sort_tmp;
+		std::vector<sort_range> sort_ranges;
+	};
+
+	struct dump_context {
+		writer* wr;
+		const dump_options opt;
+		int indent = 0;
+		static constexpr int SP_N = 64;
+		char spaces[SP_N] = "";	// fill consecutive indent_char, may be redundant
+
+		// containers being written, innermost last, instead of recursing
+		std::vector<dump_frame> frames;
+		std::vector<const member*> members;
+		std::vector<const member*> sort_tmp;
+		std::vector<sort_range> sort_ranges;
+
+		// stop once *chunk holds chunk_size bytes, used by dump_cursor
+		const std::string* chunk = nullptr;
+		size_t chunk_size = 0;
+
+		dump_context(writer* wr, const dump_options& options) : wr(wr), opt(_normalize(options)) {
+			if (opt.indent > 0) memset(spaces, opt.indent_char, SP_N);
+			else indent = -1;
+			_swap_scratch();
+		}
+
+		~dump_context() {
+			frames.clear();
+			members.clear();
+			_swap_scratch();
+		}
+
+		static dump_options _normalize(dump_options options) {
+			if (options.canonical) options.indent = -1;
+			return options;
+		}
+
+		// the buffers are borrowed from the previous dump on this thread
+		void _swap_scratch() {
+			static thread_local dump_scratch s;
+			frames.swap(s.frames);
+			members.swap(s.members);
+			sort_tmp.swap(s.sort_tmp);
+			sort_ranges.swap(s.sort_ranges);
+		}
+
+		void newline() {
+			if (indent < 0) return;
+			wr->write('\n');
+			if (indent == 0) return;
+			int n = indent;
+			while (n >= SP_N) wr->write(spaces), n -= SP_N;
+			wr->write(spaces, n);
+		}
+	};
+
+	static void _dump_number(dump_context& ctx, const number& n) {
+		ctx.opt.canonical ? _dump_number_es(ctx.wr, _to_double(n)) : _dump_number(ctx.wr, n);
+	}
+
+	// write a scalar, or open a non-empty container and push its frame
+	static void _dump_value(dump_context& ctx, const basic_json& j) {
+		// TODO use std::visit
+		switch (j.m_var.index()) {
+		case 0: return ctx.wr->write("null");
+		case 1: return j.get_bool() ? ctx.wr->write("true") : ctx.wr->write("false");
+		case 2: return _dump_number(ctx, j.get_number());
+		case 3: return _dump_string(ctx.wr, j.get_string(), ctx.opt);
+		case 4: {	// array
+			if (j._array().empty()) return ctx.wr->write("[]");
+			ctx.wr->write('[');
+			break;
+		}
+		case 6:	// packed array
+			if (j.ptr_packed()->empty()) return ctx.wr->write("[]");
+			ctx.wr->write('[');
+			break;
+		case 5: {	// object
+			auto& obj = j.get_object();
+			if (obj.empty()) return ctx.wr->write("{}");
+			ctx.wr->write('{');
+			if (ctx.opt.canonical || (ctx.opt.sort_keys && !_is_byte_ordered<object>::value)) {
+				size_t base = ctx.members.size();
+				for (auto& m : obj) ctx.members.push_back(&m);
+				_sort_members(ctx, base);
+				ctx.frames.push_back({ &j, 0, {}, base });
+			}
+			else ctx.frames.push_back({ &j, 0, obj.begin() });
+			ctx.indent += ctx.opt.indent;
+			return;
+		}
+		}
+		ctx.frames.push_back({ &j, 0, {} });
+		ctx.indent += ctx.opt.indent;
+	}
+
+	// write the next child of the innermost container, or close it
+	static void _dump_step(dump_context& ctx) {
+		dump_frame& f = ctx.frames.back();
+		const basic_json* child;
+		if (auto* nums = f.node->ptr_packed()) {
+			if (f.index == nums->size()) return _dump_close(ctx, ']');
+			if (f.index) ctx.wr->write(',');
+			ctx.newline();
+			return _dump_number(ctx, (*nums)[f.index++]);
+		}
+		if (f.node->is_array()) {
+			auto& arr = f.node->_array();
+			if (f.index == arr.size()) return _dump_close(ctx, ']');
+			if (f.index) ctx.wr->write(',');
+			ctx.newline();
+			child = &arr[f.index++];
+		}
+		else {
+			const member* m;
+			if (f.base == NOT_SORTED) {
+				if (f.it == f.node->get_object().end()) return _dump_close(ctx, '}');
+				m = &*f.it++;
+			}
+			else {
+				if (f.index == f.node->get_object().size()) {
+					ctx.members.resize(f.base);
+					return _dump_close(ctx, '}');
+				}
+				m = ctx.members[f.base + f.index];
+			}
+			if (f.index++) ctx.wr->write(',');
+			ctx.newline();
+			_dump_string(ctx.wr, m->first, ctx.opt);
+			ctx.opt.canonical ? ctx.wr->write(':') : ctx.wr->write(": ");
+			child = &m->second;
+		}
+		_dump_value(ctx, *child);	// may push a frame, f is dangling from here
+	}
+
+	// RFC 8785 orders keys by UTF-16 code units, which differs from the UTF-8 byte order only in
+	// the supplementary planes (lead bytes f0-f4), those sort before U+E000 (lead bytes ee, ef)
+	static uint8_t _utf16_rank(uint8_t c) {
+		return c < 0xee || c > 0xf4 ? c : c < 0xf0 ? c + 5 : c - 2;
+	}
+
+	// compare keys from depth on, in UTF-16 order for canonical output and byte order otherwise
+	static bool _key_less(const string& a, const string& b, size_t depth, bool utf16) {
+		size_t n = std::min(a.size(), b.size());
+		for (size_t i = depth; i < n; i++) {
+			uint8_t x = a[i], y = b[i];
+			if (x != y) return utf16 ? _utf16_rank(x) < _utf16_rank(y) : x < y;
+		}
+		return a.size() < b.size();
+	}
+
+	// sort ctx.members from base on by key, without copying keys
+	// small objects use insertion sort, larger ones an MSD radix sort on key bytes, with an
+	// explicit stack so long shared prefixes cannot exhaust the call stack
+	static void _sort_members(dump_context& ctx, size_t base) {
+		constexpr size_t SMALL = 16;
+		bool utf16 = ctx.opt.canonical;
+		auto& v = ctx.members;
+		auto less_from = [utf16](size_t depth) {
+			return [utf16, depth](const member* a, const member* b) { return _key_less(a->first, b->first, depth, utf16); };
+		};
+		// std::map keeps byte order, which is already the canonical order unless keys use the supplementary planes
+		if (std::is_sorted(v.begin() + base, v.end(), less_from(0))) return;
+
+		auto& todo = ctx.sort_ranges;
+		todo.push_back({ base, v.size(), 0 });
+		while (!todo.empty()) {
+			sort_range r = todo.back();
+			todo.pop_back();
+			if (r.last - r.first <= SMALL) {
+				auto less = less_from(r.depth);
+				for (size_t i = r.first + 1; i < r.last; i++) {
+					const member* m = v[i];
+					size_t j = i;
+					for (; j > r.first && less(m, v[j - 1]); j--) v[j] = v[j - 1];
+					v[j] = m;
+				}
+				continue;
+			}
+
+			// bucket 0 holds keys that end at depth, the byte at depth goes to bucket 1 + rank
+			size_t count[257] = {};
+			auto bucket = [&](const member* m) -> size_t {
+				auto& key = m->first;
+				if (key.size() <= r.depth) return 0;
+				uint8_t c = key[r.depth];
+				return 1 + (utf16 ? _utf16_rank(c) : c);
+			};
+			for (size_t i = r.first; i < r.last; i++) count[bucket(v[i])]++;
+			if (count[bucket(v[r.first])] == r.last - r.first) {
+				// all share the byte at depth, skip the rest of the common prefix at once
+				if (bucket(v[r.first]) == 0) continue;
+				auto& k0 = v[r.first]->first;
+				size_t lcp = k0.size();
+				for (size_t i = r.first + 1; i < r.last && lcp > r.depth; i++) {
+					auto& k = v[i]->first;
+					size_t d = r.depth + 1, n = std::min(lcp, k.size());
+					while (d < n && k[d] == k0[d]) d++;
+					lcp = d;
+				}
+				todo.push_back({ r.first, r.last, std::max(lcp, r.depth + 1) });
+				continue;
+			}
+
+			size_t pos[257];
+			for (size_t b = 0, sum = r.first; b < 257; b++) pos[b] = sum, sum += count[b];
+			ctx.sort_tmp.resize(r.last - r.first);
+			for (size_t i = r.first; i < r.last; i++) ctx.sort_tmp[pos[bucket(v[i])]++ - r.first] = v[i];
+			std::copy(ctx.sort_tmp.begin(), ctx.sort_tmp.end(), v.begin() + r.first);
+			for (size_t b = 1, start = r.first + count[0]; b < 257; start += count[b], b++) {
+				if (count[b] > 1) todo.push_back({ start, start + count[b], r.depth + 1 });
+			}
+		}
+	}
+
+	static void _dump_close(dump_context& ctx, char bracket) {
+		ctx.frames.pop_back();
+		ctx.indent -= ctx.opt.indent;
+		ctx.newline();
+		ctx.wr->write(bracket);
+	}
+
+	// run until the frame stack is empty, or until ctx.chunk is full, return true when done
+	static bool _dump_run(dump_context& ctx) {
+		if (ctx.chunk) {
+			while (!ctx.frames.empty()) {
+				if (ctx.chunk->size() >= ctx.chunk_size) return false;
+				_dump_step(ctx);
+			}
+		}
+		else while (!ctx.frames.empty()) _dump_step(ctx);
+		return true;
+	}
+
+	void _dump(dump_context& ctx) const {
+		_dump_value(ctx, *this);
+		_dump_run(ctx);
+	}
+
+public:
+	template<class Target>
+	void dump(Target& target, const dump_options& options = {}) const {
+		auto wr = writer::New(target);
+		dump_context ctx(wr.get(), options);
+		_dump(ctx);
+		if (ctx.opt.indent >= 0) wr->write('\n');
+		wr->flush();
+	}
+
+	// serializes a document piece by piece, for sinks that cannot take it all at once
+	// (non-blocking sockets, bounded buffers), the document must stay unchanged meanwhile
+	class dump_cursor
+	{
+	public:
+		dump_cursor(const basic_json& j, const dump_options& options = {})
+			: m_root(&j), m_wr(m_dummy), m_ctx(&m_wr, options) {}
+
+		dump_cursor(const dump_cursor&) = delete;
+		dump_cursor& operator=(const dump_cursor&) = delete;
+
+		// append the next piece to out and return true, or return false if there is nothing left
+		// a piece ends once out holds chunk_size bytes or more, a long string may overshoot it
+		bool next(std::string& out, size_t chunk_size) {
+			if (m_done) return false;
+			m_wr.ptr = &out;
+			m_ctx.chunk = &out;
+			m_ctx.chunk_size = chunk_size;
+			if (m_root) {
+				_dump_value(m_ctx, *m_root);
+				m_root = nullptr;
+			}
+			if (_dump_run(m_ctx)) {
+				if (m_ctx.opt.indent >= 0) out += '\n';
+				m_done = true;
+			}
+			return true;
+		}
+
+		bool done() const { return m_done; }
+
+	private:
+		const basic_json* m_root;	// not started yet
+		std::string m_dummy;
+		writer_interface<std::string> m_wr;
+		dump_context m_ctx;
+		bool m_done = false;
+	};
+
+	template<class OutIt>
+	void dump(OutIt&& iter, const dump_options& options = {}) const {
+		std::void_t<decltype(*iter++ = ' '), decltype(OutIt(iter))>(0);	// check if iter is an output iterator
+		dump(iter, options);
+	}
+
+	string dumps(const dump_options& options = {}) const {
+		string str{};
+		dump(str, options);
+		return str;
+	}
+
+	string dumps(int indent, char indent_char, bool ensure_ascii = false) {
+		return dumps(dump_options(indent, indent_char, ensure_ascii));
+	}
+
+	// hash of the canonical (RFC 8785) form, streamed into the hasher without building the string
+	// Hasher needs update(const char*, size_t) and digest(), whose result is returned
+	template<class Hasher = sha256>
+	auto canonical_hash(Hasher hasher = {}) const {
+		dump_options opt;
+		opt.canonical = true;
+		{
+			hash_writer<Hasher> wr(hasher);
+			dump_context ctx(&wr, opt);
+			_dump(ctx);
+		}
+		return hasher.digest();
+	}
+
+private:
+	struct parse_context {
+		reader* rd;
+		const parse_options opt;
+		size_t depth = 0;	// nesting level of the array/object being parsed
+		bool reuse = false;	// reload(), recycle the containers already in the target
+		string text;		// scratch for number literals and reload() keys
+		parse_error error = parse_error::ok;	// the innermost specific error, see try_parse()
+
+		// children of all arrays/objects being parsed, stacked up until each container
+		// is complete and can be built at its final size
+		std::vector<basic_json> values;
+		std::vector<std::pair<string, basic_json>> members;
+
+		// the scratch stacks are borrowed from the previous parse on this thread, so they
+		// rarely grow, unless they grew beyond SCRATCH_KEEP elements
+		static constexpr size_t SCRATCH_KEEP = 1 << 16;
+
+		struct scratch {
+			std::vector<basic_json> values;
+			std::vector<std::pair<string, basic_json>> members;
+		};
+
+		static scratch& thread_scratch() {
+			static thread_local scratch s;
+			return s;
+		}
+
+		parse_context(reader* rd, const parse_options& options) : rd(rd), opt(options) {
+			values.swap(thread_scratch().values);
+			members.swap(thread_scratch().members);
+		}
+
+		~parse_context() {
+			values.clear();
+			members.clear();
+			if (values.capacity() <= SCRATCH_KEEP) values.swap(thread_scratch().values);
+			if (members.capacity() <= SCRATCH_KEEP) members.swap(thread_scratch().members);
+		}
+
+		char read() { return rd->read(); }
+		char nonspace_read() { return rd->nonspace_read(); }
+
+		// return the failed parse result, the first error recorded wins
+		char fail(parse_error e) {
+			if (error == parse_error::ok) error = e;
+			return '\0';
+		}
+	};
+
+	template<class P, class = void>
+	struct _has_use_count : std::false_type {};
+	template<class P>
+	struct _has_use_count<P, std::void_t<decltype(std::declval<const P&>().use_count())>> : std::true_type {};
+
+	template<class M, class = void>
+	struct _has_node_type : std::false_type {};
+	template<class M>
+	struct _has_node_type<M, std::void_t<typename M::node_type>> : std::true_type {};
+
+	template<class M, class = void>
+	struct _is_byte_ordered : std::false_type {};
+	template<class M>
+	struct _is_byte_ordered<M, std::void_t<typename M::key_compare>> : std::bool_constant<
+		std::is_same_v<typename M::key_compare, std::less<typename M::key_type>> ||
+		std::is_same_v<typename M::key_compare, std::less<>>> {};
+
+	template<class M, class K, class = void>
+	struct _has_transparent_find : std::false_type {};
+	template<class M, class K>
+	struct _has_transparent_find<M, K, std::void_t<decltype(std::declval<const M&>().find(std::declval<const K&>()))>>
+		: std::true_type {};
+
+	// obj.find(key), building the key string only if the map cannot compare against key as is
+	template<class Obj>
+	static auto _find(Obj& obj, std::string_view key) {
+		if constexpr (_has_transparent_find<object, std::string_view>::value) return obj.find(key);
+		else return obj.find(string(key.data(), key.size()));
+	}
+
+	// a hash-based map whose hasher takes json17::key, find() alone would also accept std::map<K, V, std::less<>>
+	template<class M, class = void>
+	struct _hashes_keys : std::false_type {};
+	template<class M>
+	struct _hashes_keys<M, std::void_t<decltype(std::declval<const typename M::hasher&>()(std::declval<const key&>()))>>
+		: _has_transparent_find<M, key> {};
+
+	// maps hashing json17::key use its hash, the others, std::map included, search by its text and
+	// gain nothing from the key
+	template<class Obj>
+	static auto _find(Obj& obj, const key& k) {
+		if constexpr (_hashes_keys<object>::value) return obj.find(k);
+		else return _find(obj, k.str());
+	}
+
+	template<class C, class = void>
+	struct _has_reserve : std::false_type {};
+	template<class C>
+	struct _has_reserve<C, std::void_t<decltype(std::declval<C&>().reserve(size_t()))>> : std::true_type {};
+
+	// move ctx.values[base:] into out, which holds an empty array, as a packed array instead
+	// if Traits::pack_numeric_arrays and they are all numbers
+	static void _finish_array(parse_context& ctx, size_t base, basic_json& out) {
+		if constexpr (PACKED) {
+			auto first = ctx.values.begin() + base;
+			if (first != ctx.values.end() && std::all_of(first, ctx.values.end(), [](const basic_json& e) { return e.is_number(); })) {
+				auto nums = _make_smart<packed_array>();
+				nums->reserve(ctx.values.end() - first);
+				for (auto it = first; it != ctx.values.end(); ++it) nums->push_back(std::move(it->get_number()));
+				ctx.values.erase(first, ctx.values.end());
+				out.m_var = std::move(nums);
+				return;
+			}
+		}
+		_build_array(ctx, base, out._array());
+	}
+
+	// reload() parses arrays in the generic form, pack them afterwards
+	void _try_pack() {
+		if constexpr (PACKED) {
+			auto* arr = _ptr_array();
+			if (!arr || arr->empty() || !std::all_of(arr->begin(), arr->end(), [](const basic_json& e) { return e.is_number(); })) return;
+			auto nums = _make_smart<packed_array>();
+			nums->reserve(arr->size());
+			for (auto& e : *arr) nums->push_back(std::move(e.get_number()));
+			m_var = std::move(nums);
+		}
+	}
+
+	// move ctx.values[base:] into out with a single allocation
+	static void _build_array(parse_context& ctx, size_t base, array& out) {
+		if constexpr (std::is_same_v<array, std::vector<basic_json>>) {
+			// too big to be kept as scratch anyway, hand the whole buffer over instead of moving every element
+			if (base == 0 && ctx.values.size() > parse_context::SCRATCH_KEEP && out.empty()) {
+				out.swap(ctx.values);
+				return;
+			}
+		}
+		auto first = ctx.values.begin() + base;
+		out.assign(std::make_move_iterator(first), std::make_move_iterator(ctx.values.end()));
+		ctx.values.erase(first, ctx.values.end());
+	}
+
+	// move ctx.members[base:] into out, the hint makes already sorted keys cost O(1) each
+	// for a std::map, keeping the first of duplicated keys like emplace() does
+	static void _build_object(parse_context& ctx, size_t base, object& out) {
+		auto first = ctx.members.begin() + base;
+		if constexpr (_has_reserve<object>::value) out.reserve(ctx.members.end() - first);
+		for (auto it = first; it != ctx.members.end(); ++it) {
+			out.emplace_hint(out.end(), std::move(it->first), std::move(it->second));
+		}
+		ctx.members.erase(first, ctx.members.end());
+	}
+
+	// all _parse* return EOF for nothing to read, '\0'(false) for parse failed
+
+	// parse number and store to *this, ch is the read char and must be - or 0-9
+	// the literal is collected into ctx.text and converted at once by _to_number()
+	// since number do not have a terminator, return the non-number char, returning '\0' means parse failed
+	char _parse_number(parse_context& ctx, char ch) {
+		string& text = ctx.text;
+		text.clear();
+		if (ch == '-') {
+			text += ch;
+			ch = ctx.read();
+			if (!is_digit(ch)) return ctx.fail(parse_error::invalid_number);
+		}
+		if (ch != '0') {
+			do {
+				text += ch;
+				ch = ctx.read();
+			} while (is_digit(ch));
+		}
+		else {
+			text += ch;
+			ch = ctx.read();
+		}
+
+		if (ch == '.') {
+			text += ch;
+			ch = ctx.read();
+			if (!is_digit(ch)) return ctx.fail(parse_error::invalid_number);
+			do {
+				text += ch;
+				ch = ctx.read();
+			} while (is_digit(ch));
+		}
+		if (ch == 'E' || ch == 'e') {
+			text += ch;
+			ch = ctx.read();
+			if (ch == '+' || ch == '-') {
+				text += ch;
+				ch = ctx.read();
+			}
+			if (!is_digit(ch)) return ctx.fail(parse_error::invalid_number);
+			do {
+				text += ch;
+				ch = ctx.read();
+			} while (is_digit(ch));
+		}
+		m_var = _to_number(text.data(), text.data() + text.size());
+		return is_space(ch) ? ctx.nonspace_read() : ch;
+	}
+
+	// the text number_interface<> dumps for n, in out
+	static const std::string& _number_literal(const number& n, std::string& out) {
+		out.clear();
+		writer_interface<std::string> wr(out);
+		number_interface<number>::dump(&wr, n);
+		return out;
+	}
+
+	static double _to_double(const number& n) {
+		if constexpr (std::is_arithmetic_v<number>) return double(n);
+		else return number_interface<number>::to_double(n);
+	}
+
+	// convert a number literal accepted by the parser, correctly rounded
+	static number _to_number(const char* first, const char* last) {
+		if constexpr (std::is_arithmetic_v<number>) return number(literal_to_double(first, last));
+		else return number_interface<number>::parse(first, last);
+	}
+
+	// return -1 if not a valid hex4
+	// -1 at the first character that is not a hex digit, which is then the last one read
+	static int _read_hex4(parse_context& ctx) {
+		int ret = 0;
+		for (int i = 0; i < 4; i++) {
+			char h = ctx.read();
+			int d;
+			if (is_digit(h)) d = h - '0';
+			else if (unsigned(h - 'a') < 6u) d = h - 'a' + 10;
+			else if (unsigned(h - 'A') < 6u) d = h - 'A' + 10;
+			else return -1;
+			ret = (ret << 4) | d;
+		}
+		return ret;
+	}
+
+	static void _store_utf8(int cp, string& out_str) {
+		char out[4];
+		size_t n;
+		if (cp <= 0x7f) {
+			out[0] = cp;
+			n = 1;
+		}
+		else if (cp <= 0x07ff) {
+			out[0] = 0xc0 | cp >> 6;
+			out[1] = 0x80 | cp & 0x3f;
+			n = 2;
+		}
+		else if (cp <= 0xffff) {
+			out[0] = 0xe0 | cp >> 12;
+			out[1] = 0x80 | cp >> 6 & 0x3f;
+			out[2] = 0x80 | cp & 0x3f;
+			n = 3;
+		}
+		else {
+			out[0] = 0xf0 | cp >> 18;
+			out[1] = 0x80 | cp >> 12 & 0x3f;
+			out[2] = 0x80 | cp >> 6 & 0x3f;
+			out[3] = 0x80 | cp & 0x3f;
+			n = 4;
+		}
+		out_str.append(out, n);
+	}
+
+	// store the code point of a \u escape, joining surrogate pairs
+	// last_cp holds a high surrogate waiting for its low half, a lone one is kept as is
+	static void _store_escaped(int cp, int& last_cp, string& out) {
+		if (cp >= 0xD800 && cp <= 0xDBFF) {
+			if (last_cp) _store_utf8(last_cp, out);
+			last_cp = cp;
+			return;
+		}
+		if (last_cp) {
+			if (cp >= 0xDC00 && cp <= 0xDFFF) {
+				cp = ((last_cp & 0x3ff) << 10 | cp & 0x3ff) + 0x10000;
+			}
+			else _store_utf8(last_cp, out);
+			last_cp = 0;
+		}
+		_store_utf8(cp, out);
+	}
+
+	static char _parse_string(parse_context& ctx, string& out) {
+		int last_cp = 0;	// used for surrogate pair
+		for (char ch = ctx.read(); ch != '"'; ch = ctx.read()) {
+			if (ch == EOF) return ctx.fail(parse_error::unexpected_end);
+			bool escaped = ch == '\\';
+			if (escaped) ch = ctx.read();
+			if (last_cp && !(escaped && ch == 'u')) {
+				// a high surrogate not followed by \u, keep it as is
+				_store_utf8(last_cp, out);
+				last_cp = 0;
+			}
+			if (!escaped) out += ch;
+			else switch (ch)
+			{
+			case '"': 
+			case '\\':
+			case '/': out += ch; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u': {
+				int cp = _read_hex4(ctx);
+				if (cp < 0) return ctx.fail(parse_error::invalid_escape);
+				_store_escaped(cp, last_cp, out);
+				break;
+			}
+			default: return ctx.fail(parse_error::invalid_escape);
+			}
+		}
+		if (last_cp) _store_utf8(last_cp, out);
+		return ctx.nonspace_read();
+	}
+
+	// elements are parsed onto ctx.values, nested arrays stack theirs above, and moved into out at the end
+	// (parsing into ctx.values.emplace_back() directly is wrong, nested pushes may reallocate it)
+	static char _parse_array(parse_context& ctx, basic_json& out) {
+		char ch = ctx.nonspace_read();
+		if (ch == ']') return ctx.nonspace_read();
+		size_t base = ctx.values.size();
+		for (;;) {
+			basic_json value;
+			if (!(ch = value._parse(ctx, ch))) return false;
+			ctx.values.push_back(std::move(value));
+			if (ch == ']') {
+				_finish_array(ctx, base, out);
+				return ctx.nonspace_read();
+			}
+			if (ch != ',') return false;
+			ch = ctx.nonspace_read();
+		}
+	}
+
+	static char _parse_object(parse_context& ctx, object& out) {
+		char ch = ctx.nonspace_read();
+		if (ch == '}') return ctx.nonspace_read();
+		size_t base = ctx.members.size();
+		for (; ch == '"'; ch = ctx.nonspace_read()) {
+			string key;
+			basic_json value;
+			if (!(ch = _parse_string(ctx, key))) return false;
+			if (ch != ':') return false;
+			if (!(ch = value._parse(ctx, ctx.nonspace_read()))) return false;
+			ctx.members.emplace_back(std::move(key), std::move(value));
+			if (ch == '}') {
+				_build_object(ctx, base, out);
+				return ctx.nonspace_read();
+			}
+			if (ch != ',') return false;
+		}
+		return false;
+	}
+
+	// a container handed out by get_shared_*() must not be recycled behind its other owners
+	template<class P>
+	static bool _is_unique(const P& ptr) {
+		if constexpr (_has_use_count<P>::value) return ptr.use_count() == 1;
+		else return true;
+	}
+
+	// the T held by *this if it can be recycled, otherwise a new empty one
+	template<class T>
+	T& _reuse() {
+		auto* ptr = std::get_if<smart_ptr<T>>(&m_var);
+		if (ptr && ptr->get() && _is_unique(*ptr)) return **ptr;
+		m_var = _make_smart<T>();
+		return *std::get<smart_ptr<T>>(m_var);
+	}
+
+	// like _parse_array(), but parses into the existing elements first and drops the rest
+	static char _reparse_array(parse_context& ctx, array& out) {
+		size_t n = 0;
+		char ch = ctx.nonspace_read();
+		if (ch != ']') for (;;) {
+			basic_json& item = n < out.size() ? out[n] : out.emplace_back();
+			n++;
+			if (!(ch = item._parse(ctx, ch))) return false;
+			if (ch == ']') break;
+			if (ch != ',') return false;
+			ch = ctx.nonspace_read();
+		}
+		out.resize(n);
+		return ctx.nonspace_read();
+	}
+
+	// like _reparse_array() for a packed *this, numbers are parsed straight into its buffer
+	// the first element that is not a number turns it into an ordinary array for the rest
+	char _reparse_packed(parse_context& ctx) {
+		if constexpr (PACKED) {
+			auto& nums = _reuse<packed_array>();
+			size_t n = 0;
+			char ch = ctx.nonspace_read();
+			// empty arrays are never packed
+			if (ch == ']') return set_array(), ctx.nonspace_read();
+			for (;;) {
+				basic_json value;
+				if (!(ch = value._parse(ctx, ch))) return false;
+				if (!value.is_number()) {
+					auto arr = _make_smart<array>();
+					arr->reserve(n + 1);
+					for (size_t i = 0; i < n; i++) arr->emplace_back(std::move(nums[i]));
+					arr->push_back(std::move(value));
+					m_var = std::move(arr);
+					auto& out = _array();
+					while (ch == ',') {
+						if (!(ch = out.emplace_back()._parse(ctx, ctx.nonspace_read()))) return false;
+					}
+					return ch == ']' ? ctx.nonspace_read() : false;
+				}
+				if (n < nums.size()) nums[n] = std::move(value.get_number());
+				else nums.push_back(std::move(value.get_number()));
+				n++;
+				if (ch == ']') break;
+				if (ch != ',') return false;
+				ch = ctx.nonspace_read();
+			}
+			nums.resize(n);
+			return ctx.nonspace_read();
+		}
+		else return false;
+	}
+
+	// like _parse_object(), but recycles the map nodes (key buffer included) and values of out
+	// a node with the same key is preferred, so a same-shaped document reuses whole subtrees
+	static char _reparse_object(parse_context& ctx, object& out) {
+		object old;
+		old.swap(out);
+		char ch = ctx.nonspace_read();
+		if (ch == '}') return ctx.nonspace_read();
+		for (; ch == '"'; ch = ctx.nonspace_read()) {
+			ctx.text.clear();
+			if (!(ch = _parse_string(ctx, ctx.text))) return false;
+			if (ch != ':') return false;
+			ch = ctx.nonspace_read();
+			auto it = old.find(ctx.text);
+			if constexpr (_has_node_type<object>::value) {
+				typename object::node_type node;
+				if (it != old.end()) node = old.extract(it);
+				else if (!old.empty()) {
+					node = old.extract(old.begin());
+					node.key() = ctx.text;
+				}
+				if (node) {
+					if (!(ch = node.mapped()._parse(ctx, ch))) return false;
+					out.insert(std::move(node));
+				}
+				else {
+					string key = ctx.text;
+					basic_json value;
+					if (!(ch = value._parse(ctx, ch))) return false;
+					out.emplace(std::move(key), std::move(value));
+				}
+			}
+			else {
+				string key = ctx.text;
+				basic_json value;
+				if (it != old.end()) value = std::move(it->second);
+				if (!(ch = value._parse(ctx, ch))) return false;
+				out.emplace(std::move(key), std::move(value));
+			}
+			if (ch == '}') return ctx.nonspace_read();
+			if (ch != ',') return false;
+		}
+		return false;
+	}
+
+	char _parse(parse_context& ctx, char ch) {
+		if (is_digit(ch)) return _parse_number(ctx, ch);
+		else switch (ch) {
+		case '"': {
+			if (!ctx.reuse) return _parse_string(ctx, set_string());
+			string& str = _reuse<string>();
+			str.clear();
+			return _parse_string(ctx, str);
+		}
+		case '{': 
+		case '[': {
+			// recursion depth is bounded by the input otherwise, refuse before the stack runs out
+			if (ctx.depth >= ctx.opt.max_depth) return ctx.fail(parse_error::too_deep);
+			ctx.depth++;
+			char ret;
+			if (ch == '{') ret = ctx.reuse ? _reparse_object(ctx, _reuse<object>()) : _parse_object(ctx, set_object());
+			else if (!ctx.reuse) set_array(), ret = _parse_array(ctx, *this);
+			else if (is_packed()) ret = _reparse_packed(ctx);
+			else if ((ret = _reparse_array(ctx, _reuse<array>()))) _try_pack();
+			ctx.depth--;
+			return ret;
+		}
+		case '-': return _parse_number(ctx, ch);
+		case 't': 
+			if (!_parse_literal(ctx, "rue")) return false;
+			m_var = true;
+			return ctx.nonspace_read();
+		case 'f':
+			if (!_parse_literal(ctx, "alse")) return false;
+			m_var = false;
+			return ctx.nonspace_read();
+		case 'n':
+			if (!_parse_literal(ctx, "ull")) return false;
+			m_var = nullptr;
+			return ctx.nonspace_read();
+		default: return false;
+		}
+	}
+
+	// the rest of true, false or null after its first letter, a literal cut short by the end of the
+	// input is unexpected_end rather than invalid_literal
+	static bool _parse_literal(parse_context& ctx, const char* rest) {
+		for (; *rest; ++rest) {
+			char ch = ctx.read();
+			if (ch == *rest) continue;
+			ctx.fail(ch == EOF ? parse_error::unexpected_end : parse_error::invalid_literal);
+			return false;
+		}
+		return true;
+	}
+
+	bool _load(reader* rd, bool nothrow, const parse_options& options, bool reuse = false) {
+		parse_context ctx(rd, options);
+		ctx.reuse = reuse;
+		char ch = ctx.nonspace_read();
+		bool res = _parse(ctx, ch);
+		if (!res && !nothrow) throw std::invalid_argument("not a valid json");
+		return res;
+	}
+
+public:
+	// parse without throwing, a malformed input is reported in the result with the error and its position,
+	// and costs no allocation beyond freeing what was built up to it (std::bad_alloc can still be thrown)
+	// unlike parse(), anything but whitespace after the value is an error
+	static parse_result<basic_json> try_parse(std::string_view input, const parse_options& options = {}) {
+		parse_result<basic_json> res;
+		res.input = input;
+		_span_reader rd(input.data(), input.data() + input.size());
+		{
+			parse_context ctx(&rd, options);
+			char ch = res.value._parse(ctx, ctx.nonspace_read());
+			if (!ch) {
+				res.error = ctx.error != parse_error::ok ? ctx.error
+					: rd.eof() ? parse_error::unexpected_end : parse_error::unexpected_character;
+			}
+			else if (!rd.eof()) res.error = parse_error::trailing_characters;
+		}
+		res.consumed = rd.pos();
+		if (res.error == parse_error::ok) res.offset = res.consumed;
+		else {
+			res.offset = rd.eof() ? input.size() : rd.pos() - 1;
+			res.value = nullptr;
+		}
+		return res;
+	}
+
+	template<class Target>
+	bool load(Target& target, bool nothrow = false, const parse_options& options = {}) {
+		auto rd = reader::New(target);
+		return _load(rd.get(), nothrow, options);
+	}
+
+	template<class Iter>
+	bool load(Iter first, Iter last, bool nothrow = false, const parse_options& options = {}) {
+		auto rd = reader::New(first, last);
+		return _load(rd.get(), nothrow, options);
+	}
+
+	bool loads(const char* str, bool nothrow = false, const parse_options& options = {}) { return load(str, nothrow, options); }
+	bool loads(const std::string& str, bool nothrow = false, const parse_options& options = {}) { return loads(str.data(), nothrow, options); }
+
+	// same as load(), but recycles the strings, arrays and object nodes already held by *this
+	// instead of freeing them, cheap for re-reading documents of a similar shape over and over
+	template<class Target>
+	bool reload(Target& target, bool nothrow = false, const parse_options& options = {}) {
+		auto rd = reader::New(target);
+		return _load(rd.get(), nothrow, options, true);
+	}
+
+	template<class Iter>
+	bool reload(Iter first, Iter last, bool nothrow = false, const parse_options& options = {}) {
+		auto rd = reader::New(first, last);
+		return _load(rd.get(), nothrow, options, true);
+	}
+
+	bool reloads(const char* str, bool nothrow = false, const parse_options& options = {}) { return reload(str, nothrow, options); }
+	bool reloads(const std::string& str, bool nothrow = false, const parse_options& options = {}) { return reloads(str.data(), nothrow, options); }
+
+	template<class Iter, typename std::iterator_traits<Iter>::value_type = 0>
+	static basic_json parse(Iter first, Iter last, const parse_options& options = {}) {
+		basic_json j;
+		j.load(first, last, false, options);
+		return j;
+	}
+
+	static basic_json parse(const char* str, const parse_options& options = {}) { 
+		basic_json j;
+		j.load(str, false, options);
+		return j; 
+	}
+	static basic_json parse(const std::string& str, const parse_options& options = {}) { return parse(str.data(), options); }
+
+private:
+	// sax_handler building a basic_json, with the same scratch stacks as load()
+	class dom_builder : public sax_handler
+	{
+	public:
+		basic_json root;
+
+		dom_builder(const parse_options& options) : ctx(nullptr, options) {}
+
+		void reset() {
+			root = nullptr;
+			frames.clear();
+			ctx.values.clear();
+			ctx.members.clear();
+		}
+
+		bool on_null() override { return _add(nullptr); }
+		bool on_bool(bool v) override { return _add(v); }
+		bool on_number(const char* str, size_t n) override { return _add(_to_number(str, str + n)); }
+		bool on_string(const char* str, size_t n) override { return _add(basic_json(std::in_place_type<string>, str, n)); }
+		bool on_key(const char* str, size_t n) override {
+			frames.back().key.assign(str, n);
+			return true;
+		}
+
+		bool on_start_array() override {
+			frames.push_back({ false, ctx.values.size() });
+			return true;
+		}
+
+		bool on_end_array() override {
+			basic_json arr(std::in_place_type<array>);
+			_finish_array(ctx, frames.back().base, arr);
+			frames.pop_back();
+			return _add(std::move(arr));
+		}
+
+		bool on_start_object() override {
+			frames.push_back({ true, ctx.members.size() });
+			return true;
+		}
+
+		bool on_end_object() override {
+			basic_json obj(std::in_place_type<object>);
+			_build_object(ctx, frames.back().base, obj.get_object());
+			frames.pop_back();
+			return _add(std::move(obj));
+		}
+
+	private:
+		struct frame {
+			bool is_object;
+			size_t base;	// where the children start in ctx.values/ctx.members
+			string key;		// key of the member being parsed
+		};
+
+		parse_context ctx;
+		std::vector<frame> frames;
+
+		bool _add(basic_json&& value) {
+			if (frames.empty()) root = std::move(value);
+			else if (!frames.back().is_object) ctx.values.push_back(std::move(value));
+			else ctx.members.emplace_back(std::move(frames.back().key), std::move(value));
+			return true;
+		}
+	};
+
+public:
+	// incremental parser for input arriving in pieces, e.g. from a non-blocking socket
+	// feed() the bytes as they come and finish() at the end of the input, the state is kept in between
+	// without a handler it builds a basic_json, taken by result() or release() after finish()
+	// with a handler it reports each token as soon as it is complete and builds nothing
+	// unlike load(), anything but whitespace after the value is an error
+	class push_parser
+	{
+	public:
+		explicit push_parser(const parse_options& options = {})
+			: m_opt(options), m_dom(std::make_unique<dom_builder>(options)), m_handler(m_dom.get()) {}
+
+		explicit push_parser(sax_handler* handler, const parse_options& options = {})
+			: m_opt(options), m_handler(handler) {}
+
+		// parse the next n bytes, return false once the input turned out to be invalid
+		bool feed(const char* data, size_t n) {
+			const char* p = data;
+			const char* end = data + n;
+			while (p != end && m_state != state::error) {
+				switch (m_state) {
+				case state::string: p = _scan_string(p, end); break;
+				case state::number: p = _scan_number(p, end); break;
+				case state::literal: p = _scan_literal(p, end); break;
+				default:
+					if (!is_space(*p)) _structural(*p);
+					if (m_state != state::error) ++p;
+					break;
+				}
+			}
+			m_offset += p - data;
+			return m_state != state::error;
+		}
+
+		bool feed(const std::string& str) { return feed(str.data(), str.size()); }
+
+		// end of input, return true if exactly one complete value was parsed
+		bool finish() {
+			if (m_state == state::number) _end_number();
+			return m_state == state::done;
+		}
+
+		bool failed() const { return m_state == state::error; }
+
+		// bytes consumed so far, the position of the offending byte after a failure
+		size_t offset() const { return m_offset; }
+
+		basic_json&       result()       { return m_dom->root; }
+		const basic_json& result() const { return m_dom->root; }
+		basic_json release() { return std::move(m_dom->root); }
+
+		// start over for the next document, keeping the buffers
+		void reset() {
+			m_state = state::value;
+			m_frames.clear();
+			m_text.clear();
+			m_offset = 0;
+			if (m_dom) m_dom->reset();
+		}
+
+	private:
+		enum class state : uint8_t {
+			value,			// expecting a value
+			first_value,	// after '[', a value or ']'
+			first_key,		// after '{', a key or '}'
+			key,			// after ',' in an object
+			colon,			// after a key
+			after_value,	// ',' or the closing bracket
+			done,			// top level value complete, only whitespace may follow
+			string,
+			number,
+			literal,
+			error
+		};
+
+		enum class number_state : uint8_t { minus, zero, integer, fraction_mark, fraction, exponent_mark, exponent_sign, exponent };
+
+		const parse_options m_opt;
+		std::unique_ptr<dom_builder> m_dom;
+		sax_handler* m_handler;
+
+		state m_state = state::value;
+		std::vector<char> m_frames;	// '[' or '{' of the enclosing containers
+		size_t m_offset = 0;
+
+		// token in progress
+		string m_text;
+		bool m_is_key = false;
+		int m_escape = 0;		// 0 none, 1 after '\\', 2..5 reading the hex digits of \u
+		int m_hex = 0;
+		int m_last_cp = 0;		// pending high surrogate
+		number_state m_number = number_state::minus;
+		const char* m_literal = nullptr;	// "true", "false" or "null"
+		size_t m_literal_pos = 0;
+
+		void _fail() { m_state = state::error; }
+
+		void _check(bool ok) { if (!ok) _fail(); }
+
+		void _value_done() {
+			if (m_state == state::error) return;
+			m_state = m_frames.empty() ? state::done : state::after_value;
+		}
+
+		void _structural(char ch) {
+			switch (m_state) {
+			case state::first_value:
+				if (ch == ']') return _end_container('[');
+				[[fallthrough]];
+			case state::value: return _begin_value(ch);
+			case state::first_key:
+				if (ch == '}') return _end_container('{');
+				[[fallthrough]];
+			case state::key:
+				if (ch != '"') return _fail();
+				return _begin_string(true);
+			case state::colon:
+				if (ch != ':') return _fail();
+				m_state = state::value;
+				return;
+			case state::after_value:
+				if (ch == ',') m_state = m_frames.back() == '[' ? state::value : state::key;
+				else if (ch == ']' || ch == '}') _end_container(ch == ']' ? '[' : '{');
+				else _fail();
+				return;
+			default: return _fail();
+			}
+		}
+
+		void _begin_value(char ch) {
+			switch (ch) {
+			case '"': return _begin_string(false);
+			case '[':
+			case '{':
+				if (m_frames.size() >= m_opt.max_depth) return _fail();
+				m_frames.push_back(ch);
+				_check(ch == '[' ? m_handler->on_start_array() : m_handler->on_start_object());
+				if (m_state != state::error) m_state = ch == '[' ? state::first_value : state::first_key;
+				return;
+			case 't': return _begin_literal("true");
+			case 'f': return _begin_literal("false");
+			case 'n': return _begin_literal("null");
+			default:
+				if (ch != '-' && !is_digit(ch)) return _fail();
+				m_text.assign(1, ch);
+				m_number = ch == '-' ? number_state::minus : ch == '0' ? number_state::zero : number_state::integer;
+				m_state = state::number;
+				return;
+			}
+		}
+
+		void _end_container(char open) {
+			if (m_frames.empty() || m_frames.back() != open) return _fail();
+			m_frames.pop_back();
+			_check(open == '[' ? m_handler->on_end_array() : m_handler->on_end_object());
+			_value_done();
+		}
+
+		void _begin_string(bool is_key) {
+			m_text.clear();
+			m_is_key = is_key;
+			m_escape = 0;
+			m_last_cp = 0;
+			m_state = state::string;
+		}
+
+		void _end_string() {
+			if (m_last_cp) _store_utf8(m_last_cp, m_text);
+			if (m_is_key) {
+				_check(m_handler->on_key(m_text.data(), m_text.size()));
+				if (m_state != state::error) m_state = state::colon;
+			}
+			else {
+				_check(m_handler->on_string(m_text.data(), m_text.size()));
+				_value_done();
+			}
+		}
+
+		const char* _scan_string(const char* p, const char* end) {
+			while (p != end) {
+				if (m_escape == 0) {
+					// copy the run up to the next quote or backslash at once
+					const char* q = p;
+					while (q != end && *q != '"' && *q != '\\') ++q;
+					if (q != p) {
+						if (m_last_cp) _store_utf8(m_last_cp, m_text), m_last_cp = 0;
+						m_text.append(p, q - p);
+						p = q;
+						if (p == end) break;
+					}
+					if (*p++ == '"') {
+						_end_string();
+						return p;
+					}
+					m_escape = 1;
+				}
+				else if (m_escape == 1) {
+					char ch = *p++;
+					m_escape = 0;
+					if (ch == 'u') {
+						m_escape = 2;
+						m_hex = 0;
+						continue;
+					}
+					if (m_last_cp) _store_utf8(m_last_cp, m_text), m_last_cp = 0;
+					switch (ch) {
+					case '"':
+					case '\\':
+					case '/': m_text += ch; break;
+					case 'b': m_text += '\b'; break;
+					case 'f': m_text += '\f'; break;
+					case 'n': m_text += '\n'; break;
+					case 'r': m_text += '\r'; break;
+					case 't': m_text += '\t'; break;
+					default:	// same as load()
+						_fail();
+						return p - 1;
+					}
+				}
+				else {
+					char ch = *p++;
+					int digit = is_digit(ch) ? ch - '0'
+						: unsigned(ch - 'a') < 6u ? ch - 'a' + 10
+						: unsigned(ch - 'A') < 6u ? ch - 'A' + 10 : -1;
+					if (digit < 0) {
+						_fail();
+						return p - 1;
+					}
+					m_hex = m_hex << 4 | digit;
+					if (++m_escape == 6) {
+						m_escape = 0;
+						_store_escaped(m_hex, m_last_cp, m_text);
+					}
+				}
+			}
+			return p;
+		}
+
+		// grammar of _parse_number(), the number ends at the first byte that does not fit
+		const char* _scan_number(const char* p, const char* end) {
+			for (; p != end; ++p) {
+				char ch = *p;
+				switch (m_number) {
+				case number_state::minus:
+					if (!is_digit(ch)) return _fail(), p;
+					m_number = ch == '0' ? number_state::zero : number_state::integer;
+					break;
+				case number_state::zero:
+					if (ch == '.') m_number = number_state::fraction_mark;
+					else if (ch == 'e' || ch == 'E') m_number = number_state::exponent_mark;
+					else return _end_number(), p;
+					break;
+				case number_state::integer:
+				case number_state::fraction:
+					if (is_digit(ch)) break;
+					if (ch == '.' && m_number == number_state::integer) m_number = number_state::fraction_mark;
+					else if (ch == 'e' || ch == 'E') m_number = number_state::exponent_mark;
+					else return _end_number(), p;
+					break;
+				case number_state::fraction_mark:
+					if (!is_digit(ch)) return _fail(), p;
+					m_number = number_state::fraction;
+					break;
+				case number_state::exponent_mark:
+					if (ch == '+' || ch == '-') m_number = number_state::exponent_sign;
+					else if (is_digit(ch)) m_number = number_state::exponent;
+					else return _fail(), p;
+					break;
+				case number_state::exponent_sign:
+					if (!is_digit(ch)) return _fail(), p;
+					m_number = number_state::exponent;
+					break;
+				case number_state::exponent:
+					if (!is_digit(ch)) return _end_number(), p;
+					break;
+				}
+				m_text += ch;
+			}
+			return p;
+		}
+
+		void _end_number() {
+			if (m_number == number_state::minus || m_number == number_state::fraction_mark
+				|| m_number == number_state::exponent_mark || m_number == number_state::exponent_sign) {
+				return _fail();
+			}
+			_check(m_handler->on_number(m_text.data(), m_text.size()));
+			_value_done();
+		}
+
+		void _begin_literal(const char* literal) {
+			m_literal = literal;
+			m_literal_pos = 1;
+			m_state = state::literal;
+		}
+
+		const char* _scan_literal(const char* p, const char* end) {
+			for (; p != end && m_literal[m_literal_pos]; ++p, ++m_literal_pos) {
+				if (*p != m_literal[m_literal_pos]) return _fail(), p;
+			}
+			if (!m_literal[m_literal_pos]) {
+				switch (m_literal[0]) {
+				case 't': _check(m_handler->on_bool(true)); break;
+				case 'f': _check(m_handler->on_bool(false)); break;
+				default: _check(m_handler->on_null()); break;
+				}
+				_value_done();
+			}
+			return p;
+		}
+	};
+};
+
+// the reads shared by both element types of json_packed, each forwarded to the element as a const basic_json
+template<class Traits>
+template<class E>
+class basic_json<Traits>::_element_reads
+{
+public:
+	const basic_json& operator*() const { return static_cast<const E&>(*this).get(); }
+	const basic_json* operator->() const { return &**this; }
+	operator const basic_json&() const { return **this; }
+
+	json_type get_type() const { return (**this).get_type(); }
+	bool is_null()   const { return (**this).is_null(); }
+	bool is_bool()   const { return (**this).is_bool(); }
+	bool is_number() const { return (**this).is_number(); }
+	bool is_string() const { return (**this).is_string(); }
+	bool is_array()  const { return (**this).is_array(); }
+	bool is_object() const { return (**this).is_object(); }
+	bool is_packed() const { return (**this).is_packed(); }
+
+	bool                get_bool()   const { return (**this).get_bool(); }
+	number              get_number() const { return (**this).get_number(); }
+	int                 get_int()    const { return (**this).get_int(); }
+	const string&       get_string() const { return (**this).get_string(); }
+	const_array_view    get_array()  const { return (**this).get_array(); }
+	const object&       get_object() const { return (**this).get_object(); }
+	const packed_array& get_packed() const { return (**this).get_packed(); }
+
+	template<class K> decltype(auto) operator[](const K& k) const { return (**this)[k]; }
+	template<class K> decltype(auto) at(const K& k) const { return (**this).at(k); }
+	template<class K> auto find(const K& k) const { return (**this).find(k); }
+	template<class K> bool contains(const K& k) const { return (**this).contains(k); }
+
+	template<class... Args> size_t copy_to(Args&&... args) const { return (**this).copy_to(std::forward<Args>(args)...); }
+	template<class T = double> std::vector<T> as_vector() const { return (**this).template as_vector<T>(); }
+	string dumps(const dump_options& options = {}) const { return (**this).dumps(options); }
+};
+
+// an element of a const array, a pointer into an unpacked array or the number of a packed one held here,
+// so a reference taken from it must not outlive it, use auto to keep an element
+template<class Traits>
+class basic_json<Traits>::_const_element : public _element_reads<_const_element>
+{
+public:
+	explicit _const_element(const basic_json* ref) noexcept : m_ref(ref) {}
+	explicit _const_element(const number& num) : m_num(num) {}
+
+	const basic_json& get() const noexcept { return m_ref ? *m_ref : m_num; }
 
 private:
+	const basic_json* m_ref = nullptr;
+	basic_json m_num;
+};
+
+// an element of a mutable array, the array and the index, looked up again on each access so that it
+// stays valid when a write unpacks the array
+// reads do not unpack, neither does storing a number, storing anything else or asking for a
+// basic_json& with unpacked() does
+template<class Traits>
+class basic_json<Traits>::_element : public _element_reads<_element>
+{
+	using reads = _element_reads<_element>;
+
+public:
+	_element(basic_json* owner, size_t idx) noexcept : m_owner(owner), m_idx(idx) {}
+	_element(const _element&) = default;
+
+	// assign the element, not the proxy, like basic_json& would
+	_element& operator=(const _element& other) { return *this = *other; }
+
 	template<class T>
-	smart_ptr<T> _get_moved() {
-		smart_ptr<T>* ptr = std::get_if<smart_ptr<T>>(&m_var);
-		if (!ptr) return nullptr;
-		smart_ptr<T> sptr(std::move(*ptr));
-		m_var = nullptr;
-		return sptr;
+	_element& operator=(T&& v) {
+		using V = std::decay_t<T>;
+		if constexpr (std::is_same_v<V, _element> || std::is_same_v<V, _const_element>) {
+			return *this = *v;
+		}
+		else {
+			if (auto* nums = m_owner->ptr_packed()) {
+				if constexpr (std::is_same_v<V, basic_json>) {
+					if (v.is_number()) {
+						(*nums)[m_idx] = v.get_number();
+						return *this;
+					}
+				}
+				else if constexpr (std::is_same_v<V, number> || (std::is_arithmetic_v<V> && !std::is_same_v<V, bool>)) {
+					(*nums)[m_idx] = number(v);
+					return *this;
+				}
+			}
+			unpacked() = std::forward<T>(v);
+			return *this;
+		}
+	}
+
+	// the element as a basic_json, a copy of the number if the array is packed
+	const basic_json& get() const {
+		if (auto* nums = m_owner->ptr_packed()) return m_num = (*nums)[m_idx];
+		return m_owner->_array()[m_idx];
+	}
+
+	// the element as a basic_json&, unpacking a packed array
+	basic_json& unpacked() const {
+		m_owner->unpack();
+		return m_owner->_array()[m_idx];
+	}
+
+	// the number in place, a packed array stays packed
+	number& get_number() {
+		if (auto* nums = m_owner->ptr_packed()) return (*nums)[m_idx];
+		return m_owner->_array()[m_idx].get_number();
 	}
 
+	// an element of a packed array is a number, the rest throw std::bad_variant_access on it
+	// the same as on any number, without unpacking
+	string&    get_string() { return _not_number().get_string(); }
+	array_view get_array()  { return _not_number().get_array(); }
+	object&    get_object() { return _not_number().get_object(); }
+
+	template<class K> decltype(auto) operator[](K&& k) { return _not_number()[std::forward<K>(k)]; }
+	template<class K> decltype(auto) at(K&& k) { return _not_number().at(std::forward<K>(k)); }
+	template<class K> auto find(K&& k) { return _not_number().find(std::forward<K>(k)); }
+
+	template<class... Args> decltype(auto) emplace_back(Args&&... args) { return _not_number().emplace_back(std::forward<Args>(args)...); }
+	template<class... Args> auto emplace(Args&&... args) { return _not_number().emplace(std::forward<Args>(args)...); }
+	template<class... Args> auto try_emplace(Args&&... args) { return _not_number().try_emplace(std::forward<Args>(args)...); }
+
+	string& set_string() { return unpacked().set_string(); }
+	array&  set_array()  { return unpacked().set_array(); }
+	object& set_object() { return unpacked().set_object(); }
+
+	using reads::get_number;
+	using reads::get_string;
+	using reads::get_array;
+	using reads::get_object;
+	using reads::operator[];
+	using reads::at;
+	using reads::find;
+
+private:
+	basic_json& _not_number() const {
+		if (m_owner->is_packed()) throw std::bad_variant_access();
+		return m_owner->_array()[m_idx];
+	}
+
+	basic_json* m_owner;
+	size_t m_idx;
+	mutable basic_json m_num;
+};
+
+// an array, packed or not, held by pointer like a std::span, so the const members of a mutable view
+// still change the array
+// size, reads and appending numbers keep a packed array packed, anything that stores another value unpacks it
+template<class Traits>
+template<bool Const>
+class basic_json<Traits>::_array_view
+{
+	using owner_type = std::conditional_t<Const, const basic_json, basic_json>;
+
 public:
-	sptr_string_t get_moved_string() noexcept { return _get_moved<string>(); }
-	sptr_array_t  get_moved_array()  noexcept { return _get_moved<array>(); }
-	sptr_object_t get_moved_object() noexcept { return _get_moved<object>(); }
+	using value_type = std::conditional_t<Const, _const_element, _element>;
+
+	// throws std::bad_variant_access if *owner is not an array
+	explicit _array_view(owner_type* owner) : m_owner(owner) {
+		if (!owner->is_array()) throw std::bad_variant_access();
+	}
 
-	// if sptr_string_t is not copyable (i.e. std::unique_ptr), disable get_shared_*
-	template<class P = sptr_string_t>
-	std::enable_if_t<std::is_copy_assignable_v<P>, P> get_shared_string() const { 
-		auto* ptr = std::get_if<sptr_string_t>(&m_var);  
-		return ptr ? *ptr : nullptr; 
+	size_t size() const noexcept {
+		if (auto* nums = m_owner->ptr_packed()) return nums->size();
+		return m_owner->_array().size();
 	}
+	bool empty() const noexcept { return size() == 0; }
 
-	template<class P = sptr_array_t>
-	std::enable_if_t<std::is_copy_assignable_v<P>, P> get_shared_array() const { 
-		auto* ptr = std::get_if<sptr_array_t>(&m_var);  
-		return ptr ? *ptr : nullptr;
+	value_type operator[](size_t idx) const {
+		if constexpr (Const) {
+			if (auto* nums = m_owner->ptr_packed()) return value_type((*nums)[idx]);
+			return value_type(&m_owner->_array()[idx]);
+		}
+		else return value_type(m_owner, idx);
 	}
 
-	template<class P = sptr_object_t>
-	std::enable_if_t<std::is_copy_assignable_v<P>, P> get_shared_object() const { 
-		auto* ptr = std::get_if<sptr_object_t>(&m_var);  
-		return ptr ? *ptr : nullptr; 
+	// throws std::out_of_range if idx >= size()
+	value_type at(size_t idx) const {
+		if (idx >= size()) throw std::out_of_range("index out of range");
+		return (*this)[idx];
 	}
 
-private:
-	static void _dump_number(writer* wr, number num) {
-		if (!isfinite(num)) {
-			wr->write("null");
-			return;
-		}
-		char buf[32];
-		if (fabs(num) <= INT_MAX && int(num) == num) {
-			sprintf(buf, "%d", int(num));
+	value_type front() const { return (*this)[0]; }
+	value_type back()  const { return (*this)[size() - 1]; }
+
+	// hands out each element through a proxy kept in the iterator, valid until the iterator moves
+	class iterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type        = typename _array_view::value_type;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = value_type*;
+		using reference         = value_type&;
+
+		iterator(const _array_view& view, size_t idx) noexcept : m_view(view), m_idx(idx) {}
+		iterator(const iterator& other) noexcept : m_view(other.m_view), m_idx(other.m_idx) {}
+		// the proxy is not assigned, that would assign the element
+		iterator& operator=(const iterator& other) noexcept {
+			m_view = other.m_view;
+			m_idx = other.m_idx;
+			m_elem.reset();
+			return *this;
 		}
-		else {
-			sprintf(buf, "%.17g", num);	 // 17 == std::numeric_limits<double>::max_digits10
+
+		reference operator*() const { m_elem.emplace(m_view[m_idx]); return *m_elem; }
+		pointer operator->() const { return &**this; }
+
+		iterator& operator++() noexcept { ++m_idx; return *this; }
+		iterator operator++(int) noexcept { iterator it(*this); ++m_idx; return it; }
+
+		bool operator==(const iterator& other) const noexcept { return m_idx == other.m_idx; }
+		bool operator!=(const iterator& other) const noexcept { return m_idx != other.m_idx; }
+
+	private:
+		_array_view m_view;
+		size_t m_idx;
+		mutable std::optional<value_type> m_elem;
+	};
+
+	iterator begin() const noexcept { return iterator(*this, 0); }
+	iterator end()   const noexcept { return iterator(*this, size()); }
+
+	// construct the element from args, a number is appended to a packed array as it is
+	template<class... Args>
+	value_type emplace_back(Args&&... args) const {
+		static_assert(!Const, "a const array cannot be changed");
+		if (auto* nums = m_owner->ptr_packed()) {
+			basic_json v(std::forward<Args>(args)...);
+			if (v.is_number()) {
+				nums->push_back(v.get_number());
+				return value_type(m_owner, nums->size() - 1);
+			}
+			m_owner->unpack();
+			m_owner->_array().push_back(std::move(v));
 		}
-		wr->write_c(buf);
+		else m_owner->_array().emplace_back(std::forward<Args>(args)...);
+		return value_type(m_owner, size() - 1);
 	}
 
-	static constexpr char HEX[] = "0123456789abcdef";
+	void push_back(const basic_json& v) const { emplace_back(v); }
+	void push_back(basic_json&& v) const { emplace_back(std::move(v)); }
 
-	static void _write_hex4(int cp, char buf[]) {
-		// 0, 1 is '\\' 'u'
-		buf[2] = HEX[cp >> 12];
-		buf[3] = HEX[(cp >> 8) & 0x0f];
-		buf[4] = HEX[(cp >> 4) & 0x0f];
-		buf[5] = HEX[cp & 0x0f];
+	void pop_back() const {
+		static_assert(!Const, "a const array cannot be changed");
+		if (auto* nums = m_owner->ptr_packed()) nums->pop_back();
+		else m_owner->_array().pop_back();
 	}
 
-	static void _dump_string(writer* wr, const string& str, bool ensure_ascii) {
-		
-		wr->write('"');
-		size_t n = str.length();
-		for (size_t i = 0; i < n; i++) {
-			char ch = str[i];
-			switch (ch) {
-			case '"': wr->write("\\\""); break;
-			case '\\': wr->write("\\\\"); break;
-			case '\b': wr->write("\\b"); break;
-			case '\f': wr->write("\\f"); break;
-			case '\n': wr->write("\\n"); break;
-			case '\r': wr->write("\\r"); break;
-			case '\t': wr->write("\\t"); break;
-			case '\x7f': wr->write("\\u007f"); break;
-			default:
-				uint8_t uch = ch;
-				if (uch < 0x20) {
-					char buf[] = "\\u0000";
-					buf[4] = ch < 0x10 ? '0' : '1';
-					buf[5] = HEX[ch & 0x0f];
-					wr->write(buf);
-					continue;
-				}
-				if (uch < 0x80 || !ensure_ascii) {
-					wr->write(ch);
-					continue;
-				}
-				
-				// ensure ascii, uch >= 0x80
-				if (uch < 0xc2 || uch > 0xf4) {
-					wr->write("\\ufffd");
-					continue;
-				}
-				uint8_t uch2 = str[++i];
-				if (uch2 < 0x80 || uch2 >= 0xc0) {
-					wr->write("\\ufffd\\ufffd");
-					continue;
-				}
-				char buf[] = "\\u0000";
-				int u8len = uch < 0xe0 ? 2 : uch < 0xf0 ? 3 : 4;
-				if (u8len != 4) {
-					int cp = 0;
-					if (u8len == 2) cp = (uch & 0x1f) << 6 | uch2 & 0x3f;
-					else {
-						uint8_t uch3 = str[++i];
-						if (uch3 < 0x80 || uch3 >= 0xc0) {
-							for (int ii = 0; ii < 3; ii++) wr->write("\\ufffd");
-							continue;
-						}
-						cp = (uch & 0x0f) << 12 | (uch2 & 0x3f) << 6 | uch3 & 0x3f;
-					}
-					_write_hex4(cp, buf);
-					wr->write(buf);
-				}
-				else {	// 4-byte
-					uint8_t uch3 = str[++i];
-					if (uch3 < 0x80 || uch3 >= 0xc0) {
-						for (int ii = 0; ii < 3; ii++) wr->write("\\ufffd");
-						continue;
-					}
-					uint8_t uch4 = str[++i];
-					int cp = (uch & 0x07) << 18 | (uch2 & 0x3f) << 12 | (uch3 & 0x3f) << 6 | uch4 & 0x3f;
-					if (uch4 < 0x80 || uch4 >= 0xc0 || cp > 0x10ffff) {
-						for (int ii = 0; ii < 4; ii++) wr->write("\\ufffd");
-						continue;
-					}
-					cp -= 0x10000;
-					_write_hex4(0xD800 | cp >> 10, buf);
-					wr->write(buf);
-					_write_hex4(0xDC00 | cp & 0x3ff, buf);
-					wr->write(buf);
-				}
-			}
-		}
-		wr->write('"');
+	void clear() const {
+		static_assert(!Const, "a const array cannot be changed");
+		if (auto* nums = m_owner->ptr_packed()) nums->clear();
+		else m_owner->_array().clear();
 	}
 
-	struct dump_context {
-		writer* wr;
-		const dump_options opt;
-		int indent = 0;
-		static constexpr int SP_N = 64;
-		char spaces[SP_N] = "";	// fill consecutive indent_char, may be redundant
+	void reserve(size_t n) const {
+		static_assert(!Const, "a const array cannot be changed");
+		if (auto* nums = m_owner->ptr_packed()) nums->reserve(n);
+		else m_owner->_array().reserve(n);
+	}
 
-		dump_context(writer* wr, const dump_options& options) : opt(options), wr(wr) {
-			if (opt.indent > 0) memset(spaces, opt.indent_char, SP_N);
-			else indent = -1;
+	// growing adds nulls, which unpacks a packed array, shrinking does not
+	void resize(size_t n) const {
+		static_assert(!Const, "a const array cannot be changed");
+		auto* nums = m_owner->ptr_packed();
+		if (nums && n <= nums->size()) {
+			nums->resize(n);
+			return;
 		}
+		m_owner->unpack();
+		m_owner->_array().resize(n);
+	}
 
-		void newline() {
-			if (indent < 0) return;
-			wr->write('\n');
-			if (indent == 0) return;
-			int n = indent;
-			while (n >= SP_N) wr->write(spaces), n -= SP_N;
-			wr->write(spaces, n);
-		}
+	// the array of basic_json, unpacking a packed array
+	array& unpacked() const {
+		static_assert(!Const, "a const array cannot be changed");
+		m_owner->unpack();
+		return m_owner->_array();
+	}
+
+private:
+	owner_type* m_owner;
+};
+
+using json           = basic_json<json_traits>;
+using json_shared    = basic_json<json_shared_traits>;
+using json_inplace   = basic_json<json_inplace_traits>;
+using json_pool      = basic_json<json_pool_traits>;
+using json_unordered = basic_json<json_unordered_traits>;
+using json_packed    = basic_json<json_packed_traits>;
+using json_raw       = basic_json<json_raw_traits>;
+using json_decimal   = basic_json<json_decimal_traits>;
+
+// e.g. if (auto res = json17::try_parse(text)) use(res.value); else log(res.line(), res.column(), to_string(res.error));
+template<class Json = json>
+parse_result<Json> try_parse(std::string_view input, const parse_options& options = {}) {
+	return Json::try_parse(input, options);
+}
+
+// destroys discarded objects on a background thread, started on first use
+class _reclaimer
+{
+public:
+	struct item {
+		virtual ~item() = default;
 	};
 
-	void _dump(dump_context& ctx) const {
-		// TODO use std::visit
-		switch (m_var.index()) {
-		case 0: return ctx.wr->write("null");
-		case 1: return get_bool() ? ctx.wr->write("true") : ctx.wr->write("false");
-		case 2: return _dump_number(ctx.wr, get_number());
-		case 3: return _dump_string(ctx.wr, get_string(), ctx.opt.ensure_ascii);
-		case 4: {	// array
-			auto& arr = get_array();
-			if (arr.empty()) return ctx.wr->write("[]");
-			ctx.wr->write('[');
-			ctx.indent += ctx.opt.indent;
-			bool first = true;
-			for (auto& j : arr) {
-				if (first) first = false;
-				else ctx.wr->write(',');
-				ctx.newline();
-				j._dump(ctx);
-			}
-			ctx.indent -= ctx.opt.indent;
-			ctx.newline();
-			return ctx.wr->write(']');
-		}
-		case 5: {	// object
-			auto& obj = get_object();
-			if (obj.empty()) return ctx.wr->write("{}");
-			ctx.wr->write('{');
-			ctx.indent += ctx.opt.indent;
-			bool first = true;
-			for (auto& p : obj) {
-				if (first) first = false;
-				else ctx.wr->write(',');
-				ctx.newline();
-				_dump_string(ctx.wr, p.first, ctx.opt.ensure_ascii);
-				ctx.wr->write(": ");
-				p.second._dump(ctx);
-			}
-			ctx.indent -= ctx.opt.indent;
-			ctx.newline();
-			return ctx.wr->write('}');
-		}
-		}
+	template<class T>
+	struct holder : item {
+		T value;
+		holder(T&& v) : value(std::move(v)) {}
+	};
+
+	static _reclaimer& instance() {
+		static _reclaimer r;
+		return r;
 	}
 
-public:
-	template<class Target>
-	void dump(Target& target, const dump_options& options = {}) const {
-		auto wr = writer::New(target);
-		dump_context ctx(wr.get(), options);
-		_dump(ctx);
-		if (options.indent >= 0) wr->write('\n');
+	void push(std::unique_ptr<item> p) {
+		{
+			std::lock_guard<std::mutex> lk(m_mutex);
+			m_queue.push_back(std::move(p));
+		}
+		m_cv.notify_one();
 	}
 
-	template<class OutIt>
-	void dump(OutIt&& iter, const dump_options& options = {}) const {
-		std::void_t<decltype(*iter++ = ' '), decltype(OutIt(iter))>(0);	// check if iter is an output iterator
-		dump(iter, options);
+	// wait until everything pushed so far is destroyed
+	void drain() {
+		std::unique_lock<std::mutex> lk(m_mutex);
+		m_cv.wait(lk, [&] { return m_queue.empty() && !m_busy; });
 	}
 
-	string dumps(const dump_options& options = {}) const {
-		string str{};
-		dump(str, options);
-		return str;
+	// whatever is still queued at exit is destroyed before the program ends
+	~_reclaimer() {
+		{
+			std::lock_guard<std::mutex> lk(m_mutex);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
 	}
 
-	string dumps(int indent, char indent_char, bool ensure_ascii = false) {
-		return dumps(dump_options(indent, indent_char, ensure_ascii));
+private:
+	_reclaimer() : m_thread([this] { _run(); }) {}
+
+	void _run() {
+		std::vector<std::unique_ptr<item>> batch;
+		std::unique_lock<std::mutex> lk(m_mutex);
+		for (;;) {
+			m_cv.wait(lk, [&] { return !m_queue.empty() || m_stop; });
+			if (m_queue.empty()) return;
+			batch.swap(m_queue);
+			m_busy = true;
+			lk.unlock();
+			batch.clear();
+			lk.lock();
+			m_busy = false;
+			m_cv.notify_all();
+		}
 	}
 
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::vector<std::unique_ptr<item>> m_queue;
+	bool m_busy = false;
+	bool m_stop = false;
+	std::thread m_thread;
+};
+
+// hand a document (or anything else) over to a background thread to be destroyed, so freeing
+// a large tree does not add to the caller's latency, e.g. json17::dispose_async(std::move(doc))
+template<class T>
+void dispose_async(T&& doc) {
+	static_assert(!std::is_lvalue_reference_v<T>, "move the document in");
+	_reclaimer::instance().push(std::make_unique<_reclaimer::holder<T>>(std::move(doc)));
+}
+
+// wait until every dispose_async() so far has finished
+inline void dispose_wait() { _reclaimer::instance().drain(); }
+
+// holds the current version of a document that is read far more often than it changes, e.g. live
+// configuration: readers take a snapshot() without locking, writers publish() a replacement built
+// off to the side, and a version is deleted once no snapshot of it remains
+// snapshots are protected by hazard pointers, one slot per live snapshot out of SLOTS, releasing the
+// last snapshot of a replaced version deletes it, unless a writer holds the lock and does it instead
+template<class Traits = json_traits>
+class versioned_document
+{
+public:
+	using document = basic_json<Traits>;
+	static constexpr size_t SLOTS = 128;
+
 private:
-	// all _parse* return EOF for nothing to read, '\0'(false) for parse failed
+	struct alignas(64) slot {
+		std::atomic<bool> busy{ false };
+		std::atomic<const document*> hazard{ nullptr };
+	};
 
-	// parse number and store to *this, ch is the read char and must be - or 0-9
-	// since number do not have a terminator, return the non-number char, returning '\0' means parse failed
-	char _parse_number(reader* rd, char ch) {
-		bool neg = ch == '-';
-		if (neg) {
-			ch = rd->read();
-			if (!isdigit(ch)) return false;
+public:
+	// a version of the document, kept alive while the snapshot exists, do not keep it for long
+	// as each live snapshot occupies a slot and blocks reclaiming its version
+	class snapshot
+	{
+	public:
+		snapshot(snapshot&& other) noexcept
+			: m_owner(other.m_owner), m_slot(std::exchange(other.m_slot, nullptr)), m_doc(other.m_doc) {}
+		snapshot& operator=(snapshot&& other) noexcept {
+			if (this != &other) {
+				_release();
+				m_owner = other.m_owner;
+				m_slot = std::exchange(other.m_slot, nullptr);
+				m_doc = other.m_doc;
+			}
+			return *this;
 		}
-		number num = 0;
-		if (ch != '0') {
-			do {
-				num = num * 10 + (ch - '0');
-				ch = rd->read();
-			} while (isdigit(ch));
+		~snapshot() { _release(); }
+
+		const document& operator*() const noexcept { return *m_doc; }
+		const document* operator->() const noexcept { return m_doc; }
+		const document* get() const noexcept { return m_doc; }
+
+	private:
+		friend class versioned_document;
+		snapshot(const versioned_document* owner, slot* s, const document* doc) : m_owner(owner), m_slot(s), m_doc(doc) {}
+
+		void _release() {
+			if (!m_slot) return;
+			// seq_cst pairs with _publish(), either its scan misses the hazard or this sees the new version
+			m_slot->hazard.store(nullptr, std::memory_order_seq_cst);
+			m_slot->busy.store(false, std::memory_order_release);
+			m_slot = nullptr;
+			// a replaced version is not deleted by anyone else until the next publish()
+			if (m_owner->m_current.load(std::memory_order_seq_cst) != m_doc) m_owner->_request_reclaim();
 		}
-		else ch = rd->read();
 
-		if (ch == '.') {
-			number base = 1;
-			while (isdigit(ch = rd->read())) {
-				base /= 10;
-				num += base * (ch - '0');
+		const versioned_document* m_owner;
+		slot* m_slot;
+		const document* m_doc;
+	};
+
+	explicit versioned_document(document doc = {}) : m_current(new document(std::move(doc))) {}
+
+	// no snapshot may outlive the holder
+	~versioned_document() {
+		delete m_current.load();
+		for (auto* doc : m_retired) delete doc;
+	}
+
+	versioned_document(const versioned_document&) = delete;
+	versioned_document& operator=(const versioned_document&) = delete;
+
+	// wait-free unless more than SLOTS snapshots are alive at once, then it yields until one goes away
+	snapshot read() const {
+		static thread_local size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+		for (size_t i = hint;; i++) {
+			slot& s = m_slots[i % SLOTS];
+			if (s.busy.load(std::memory_order_relaxed) || s.busy.exchange(true, std::memory_order_acquire)) {
+				if ((i + 1 - hint) % SLOTS == 0) std::this_thread::yield();
+				continue;
 			}
-		}
-		if (ch == 'E' || ch == 'e') {
-			ch = rd->read();
-			bool eneg = ch == '-';
-			if (ch == '+' || ch == '-') ch = rd->read();
-			if (!isdigit(ch)) return false;
-			int expo = ch - '0';
-			while (isdigit(ch = rd->read())) {
-				expo = expo * 10 + (ch - '0');
+			hint = i % SLOTS;
+			// announce the pointer, then make sure it was not replaced (and possibly reclaimed) meanwhile
+			const document* doc = m_current.load(std::memory_order_acquire);
+			for (;;) {
+				s.hazard.store(doc, std::memory_order_seq_cst);
+				const document* again = m_current.load(std::memory_order_seq_cst);
+				if (again == doc) break;
+				doc = again;
 			}
-			num *= pow(10, eneg ? -expo : expo);
+			return snapshot(this, &s, doc);
 		}
-		m_var = neg ? -num : num;
-		return isspace(ch) ? rd->nonspace_read() : ch;
 	}
 
-	static int _read_hex4(reader* rd) {
-		char h[5]{ rd->read(), rd->read(), rd->read(), rd->read(), '\0' };
-		int ret = 0;
-		for (int i = 0; i < 4; i++) {
-			int bits = (3 - i) * 4;
-			if (isdigit(h[i])) ret |= (h[i] - '0') << bits;
-			else if (unsigned(h[i] - 'a') < 6u) ret |= (h[i] - 'a' + 10) << bits;
-			else if (unsigned(h[i] - 'A') < 6u) ret |= (h[i] - 'A' + 10) << bits;
-			else return false;
+	// replace the current version, the old one is deleted once no snapshot refers to it
+	void publish(document doc) {
+		auto* next = new document(std::move(doc));
+		{
+			std::lock_guard<std::mutex> lk(m_write);
+			_publish(next);
 		}
-		return ret;
+		_try_reclaim();
 	}
 
-	static void _store_utf8(int cp, string& out_str) {
-		char out[5] = "";
-		if (cp <= 0x7f) {
-			out[0] = cp;
-			out[1] = 0;
-		}
-		else if (cp <= 0x07ff) {
-			out[0] = 0xc0 | cp >> 6;
-			out[1] = 0x80 | cp & 0x3f;
-			out[2] = 0;
-		}
-		else if (cp <= 0xffff) {
-			out[0] = 0xe0 | cp >> 12;
-			out[1] = 0x80 | cp >> 6 & 0x3f;
-			out[2] = 0x80 | cp & 0x3f;
-			out[3] = 0;
-		}
-		else {
-			out[0] = 0xf0 | cp >> 18;
-			out[1] = 0x80 | cp >> 12 & 0x3f;
-			out[2] = 0x80 | cp >> 6 & 0x3f;
-			out[3] = 0x80 | cp & 0x3f;
-			out[4] = 0;
+	// copy the current version, let f modify the copy and publish it, concurrent updates are serialized
+	template<class F>
+	void update(F&& f) {
+		{
+			std::lock_guard<std::mutex> lk(m_write);
+			auto next = std::make_unique<document>(*m_current.load(std::memory_order_acquire));
+			f(*next);
+			_publish(next.release());
 		}
-		out_str += out;
+		_try_reclaim();
 	}
 
-	static char _parse_string(reader* rd, string& out) {
-		int last_cp = 0;	// used for surrogate pair
-		for (char ch = rd->read(); ch != '"'; ch = rd->read()) {
-			if (ch == EOF) return false;
-			if (ch != '\\') out += ch;
-			else switch (ch = rd->read())
-			{
-			case '"': 
-			case '\\':
-			case '/': out += ch; break;
-			case 'b': out += '\b'; break;
-			case 'f': out += '\f'; break;
-			case 'n': out += '\n'; break;
-			case 'r': out += '\r'; break;
-			case 't': out += '\t'; break;
-			case 'u': {
-				int cp = _read_hex4(rd);
-				if (!cp) return false;
-				if (cp >= 0xD800 && cp <= 0xDBFF) {
-					last_cp = cp;
-					continue;
-				}
-				else if (last_cp) {
-					if (cp >= 0xDC00 && cp <= 0xDFFF) {
-						cp = ((last_cp & 0x3ff) << 10 | cp & 0x3ff) + 0x10000;
-					}
-					else _store_utf8(last_cp, out);
-					last_cp = 0;
-				}
-				_store_utf8(cp, out);
-				continue;
-			}
-			default: (out += '\\') += ch; break;	// TODO return false?
-			}
+	// retry deleting old versions that are no longer in use, snapshots normally do this as they go
+	void reclaim() {
+		std::lock_guard<std::mutex> lk(m_write);
+		_reclaim();
+	}
 
-			if (last_cp) {
-				_store_utf8(last_cp, out);
-				last_cp = 0;
-			}
-		}
-		return rd->nonspace_read();
+	// versions replaced but still referenced by snapshots
+	size_t retired() const {
+		std::lock_guard<std::mutex> lk(m_write);
+		return m_retired.size();
 	}
 
-	static char _parse_array(reader* rd, array& out) {
-		char ch = rd->nonspace_read();
-		if (ch == ']') return rd->nonspace_read();
-		for (;;) {
-			ch = out.emplace_back()._parse(rd, ch);
-			if (!ch) return false;
-			if (ch == ']') return rd->nonspace_read();
-			if (ch != ',') return false;
-			ch = rd->nonspace_read();
+private:
+	void _publish(document* next) {
+		m_retired.push_back(m_current.exchange(next, std::memory_order_seq_cst));
+		_reclaim();
+	}
+
+	// called by snapshots, a failed try_lock leaves the request to the writer holding the lock
+	void _request_reclaim() const {
+		m_reclaim_requested.store(true, std::memory_order_seq_cst);
+		_try_reclaim();
+	}
+
+	void _try_reclaim() const {
+		while (m_reclaim_requested.load(std::memory_order_seq_cst)) {
+			std::unique_lock<std::mutex> lk(m_write, std::try_to_lock);
+			if (!lk) return;
+			m_reclaim_requested.store(false, std::memory_order_relaxed);
+			_reclaim();
 		}
 	}
 
-	static char _parse_object(reader* rd, object& out) {
-		char ch = rd->nonspace_read();
-		if (ch == '}') return rd->nonspace_read();
-		for (; ch == '"'; ch = rd->nonspace_read()) {
-			string key;
-			basic_json value;
-			if (!(ch = _parse_string(rd, key))) return false;
-			if (ch != ':') return false;
-			if (!(ch = value._parse(rd, rd->nonspace_read()))) return false;
-			out.emplace(std::move(key), std::move(value));
-			if (ch == '}') return rd->nonspace_read();
-			if (ch != ',') return false;
+	void _reclaim() const {
+		m_hazards.clear();
+		for (auto& s : m_slots) {
+			if (auto* doc = s.hazard.load(std::memory_order_seq_cst)) m_hazards.push_back(doc);
 		}
-		return false;
+		std::sort(m_hazards.begin(), m_hazards.end());
+		size_t kept = 0;
+		for (auto* doc : m_retired) {
+			if (std::binary_search(m_hazards.begin(), m_hazards.end(), doc)) m_retired[kept++] = doc;
+			else delete doc;
+		}
+		m_retired.resize(kept);
 	}
 
-	char _parse(reader* rd, char ch) {
-		if (isdigit(ch)) return _parse_number(rd, ch);
-		else switch (ch) {
-		case '"': return _parse_string(rd, set_string());
-		case '{': return _parse_object(rd, set_object());
-		case '[': return _parse_array(rd, set_array());
-		case '-': return _parse_number(rd, ch);
-		case 't': 
-			if (rd->read() != 'r' || rd->read() != 'u' || rd->read() != 'e') return false;
-			m_var = true;
-			return rd->nonspace_read();
-		case 'f':
-			if (rd->read() != 'a' || rd->read() != 'l' || rd->read() != 's' || rd->read() != 'e') return false;
-			m_var = false;
-			return rd->nonspace_read();
-		case 'n':
-			if (rd->read() != 'u' || rd->read() != 'l' || rd->read() != 'l') return false;
-			m_var = nullptr;
-			return rd->nonspace_read();
-		default: return false;
+	std::atomic<document*> m_current;
+	mutable slot m_slots[SLOTS];
+
+	mutable std::mutex m_write;	// writers, and snapshots releasing a replaced version
+	mutable std::vector<document*> m_retired;
+	mutable std::vector<const document*> m_hazards;
+	mutable std::atomic<bool> m_reclaim_requested{ false };
+};
+
+#ifdef JSON17_HAS_COROUTINES
+
+struct _task_promise_base {
+	std::coroutine_handle<> continuation;
+	std::exception_ptr error;
+
+	// resume whoever awaited the task, symmetric transfer keeps long chains off the stack
+	struct final_awaiter {
+		bool await_ready() noexcept { return false; }
+		template<class Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+			auto next = h.promise().continuation;
+			return next ? next : std::noop_coroutine();
 		}
+		void await_resume() noexcept {}
+	};
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	final_awaiter final_suspend() noexcept { return {}; }
+	void unhandled_exception() { error = std::current_exception(); }
+};
+
+template<class T>
+struct _task_promise : _task_promise_base {
+	std::optional<T> value;
+	template<class U>
+	void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+	T result() {
+		if (error) std::rethrow_exception(error);
+		return std::move(*value);
 	}
+};
 
-	bool _load(reader* rd, bool nothrow) {
-		char ch = rd->nonspace_read();
-		bool res = _parse(rd, ch);
-		if (!res && !nothrow) throw std::invalid_argument("not a valid json");
-		return res;
+template<>
+struct _task_promise<void> : _task_promise_base {
+	void return_void() {}
+	void result() {
+		if (error) std::rethrow_exception(error);
 	}
+};
 
+// lazily started coroutine returned by async_parse() and async_dump()
+// co_await it from another coroutine, or start() it and get() the result once done()
+template<class T = void>
+class task
+{
 public:
-	template<class Target>
-	bool load(Target& target, bool nothrow = false) {
-		auto rd = reader::New(target);
-		return _load(rd.get(), nothrow);
+	struct promise_type : _task_promise<T> {
+		task get_return_object() { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+	};
+
+	task(task&& other) noexcept : m_h(std::exchange(other.m_h, {})) {}
+	task& operator=(task&& other) noexcept {
+		if (this != &other) {
+			if (m_h) m_h.destroy();
+			m_h = std::exchange(other.m_h, {});
+		}
+		return *this;
 	}
+	~task() { if (m_h) m_h.destroy(); }
 
-	template<class Iter>
-	bool load(Iter first, Iter last, bool nothrow = false) {
-		static_assert(std::is_same_v<std::iterator_traits<Iter>::value_type, char>);
-		auto rd = reader::New(first, last);
-		return _load(rd.get(), nothrow);
+	bool await_ready() const noexcept { return false; }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+		m_h.promise().continuation = caller;
+		return m_h;
 	}
+	T await_resume() { return m_h.promise().result(); }
 
-	bool loads(const char* str, bool nothrow = false) { return load(str, nothrow); }
-	bool loads(const std::string& str, bool nothrow = false) { return loads(str.data(), nothrow); }
+	// run until the first suspension, the rest is driven by whatever resumes the awaited streams
+	void start() { if (!m_h.done()) m_h.resume(); }
+	bool done() const { return m_h.done(); }
+	T get() { return m_h.promise().result(); }
 
-	template<class Iter, typename std::iterator_traits<Iter>::value_type = 0>
-	static basic_json parse(Iter first, Iter last) {
-		basic_json j;
-		j.load(first, last);
-		return j;
+private:
+	explicit task(std::coroutine_handle<promise_type> h) : m_h(h) {}
+	std::coroutine_handle<promise_type> m_h;
+};
+
+// parse the whole of an awaitable byte stream without blocking a thread
+// co_await source.read_some(char* buf, size_t n) yields the number of bytes read, 0 at the end
+// throws std::invalid_argument like load(), source must outlive the task
+template<class Json = json, class Source>
+task<Json> async_parse(Source& source, parse_options options = {}) {
+	typename Json::push_parser parser(options);
+	char buf[4096];
+	for (;;) {
+		size_t n = co_await source.read_some(buf, sizeof(buf));
+		if (n == 0) break;
+		if (!parser.feed(buf, n)) throw std::invalid_argument("not a valid json");
 	}
+	if (!parser.finish()) throw std::invalid_argument("not a valid json");
+	co_return parser.release();
+}
 
-	static basic_json parse(const char* str) { 
-		basic_json j;
-		j.load(str);
-		return j; 
+// serialize j to an awaitable byte stream, at most about chunk_size bytes are buffered at a time
+// co_await sink.write(const char* data, size_t n) must take all n bytes before resuming
+// j and sink must outlive the task, j must stay unchanged meanwhile
+template<class Json, class Sink>
+task<> async_dump(const Json& j, Sink& sink, dump_options options = {}, size_t chunk_size = 1 << 16) {
+	typename Json::dump_cursor cursor(j, options);
+	std::string buf;
+	buf.reserve(chunk_size);
+	while (cursor.next(buf, chunk_size)) {
+		co_await sink.write(buf.data(), buf.size());
+		buf.clear();
 	}
-	static basic_json parse(const std::string& str) { return parse(str.data()); }
-};
+}
 
-using json         = basic_json<json_traits>;
-using json_shared  = basic_json<json_shared_traits>;
-using json_inplace = basic_json<json_inplace_traits>;
+#endif
 
 }
\ No newline at end of file
@@ -0,0 +1,293 @@
+#pragma once
+
+// zlib support for json17, link with zlib (-lz)
+// wrap a binary stream in zlib_istream / zlib_ostream and pass it to load() / dump() like any other target:
+//	std::ifstream file("big.json.gz", std::ios::binary);
+//	json17::zlib_istream src{ file };
+//	j.load(src);
+
+#include <algorithm>	// min, max, clamp
+#include <condition_variable>
+#include <exception>	// exception_ptr
+#include <thread>
+#include <utility>	// exchange
+#include <zlib.h>
+
+#include "json17.h"
+
+
+namespace json17 {
+
+enum class zlib_format {
+	automatic,	// gzip or zlib when reading, gzip when writing
+	gzip,
+	zlib,
+	deflate		// raw, without header and checksum
+};
+
+// compressed input for load() / reload()
+struct zlib_istream {
+	std::istream& is;
+	zlib_format format = zlib_format::automatic;
+	bool threaded = false;	// inflate on a helper thread, overlapping with parsing
+	size_t buffer_size = 1 << 20;
+};
+
+// compressed output for dump(), the stream is finished when dump() returns, and left unfinished if it throws
+// dumping to the same zlib_ostream again appends another gzip member, which readers concatenate
+struct zlib_ostream {
+	std::ostream& os;
+	zlib_format format = zlib_format::gzip;
+	int level = Z_DEFAULT_COMPRESSION;
+	size_t buffer_size = 1 << 20;
+};
+
+inline int _zlib_window_bits(zlib_format format, bool reading) {
+	switch (format) {
+	case zlib_format::zlib: return MAX_WBITS;
+	case zlib_format::deflate: return -MAX_WBITS;
+	case zlib_format::automatic: if (reading) return MAX_WBITS + 32;
+		[[fallthrough]];
+	default: return MAX_WBITS + 16;
+	}
+}
+
+// pulls compressed bytes from an istream and hands out the inflated ones
+class _inflater
+{
+public:
+	_inflater(const zlib_istream& src) : m_is(&src.is), m_in(std::min<size_t>(src.buffer_size, 1 << 18)) {
+		m_multi = src.format != zlib_format::deflate;
+		if (inflateInit2(&m_zs, _zlib_window_bits(src.format, true)) != Z_OK)
+			throw std::runtime_error("inflateInit2 failed");
+	}
+	~_inflater() { inflateEnd(&m_zs); }
+
+	_inflater(const _inflater&) = delete;
+	_inflater& operator=(const _inflater&) = delete;
+
+	// fill out with up to n bytes, return the count, 0 only at the end of the data
+	// bytes inflated before an error are returned first, the error is thrown by the next call
+	size_t inflate_some(char* out, size_t n) {
+		if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+		m_zs.next_out = reinterpret_cast<Bytef*>(out);
+		m_zs.avail_out = uInt(std::min<size_t>(n, UINT_MAX));
+		size_t total = m_zs.avail_out;
+		try {
+			while (m_zs.avail_out && !m_done) {
+				if (m_zs.avail_in == 0 && !_read_input())
+					throw std::runtime_error("truncated compressed data");
+				int r = ::inflate(&m_zs, Z_NO_FLUSH);
+				if (r == Z_STREAM_END) {
+					// gzip files may hold several members back to back
+					if (m_multi && (m_zs.avail_in || _read_input())) inflateReset(&m_zs);
+					else m_done = true;
+				}
+				else if (r != Z_OK && r != Z_BUF_ERROR)
+					throw std::runtime_error(m_zs.msg ? m_zs.msg : "corrupt compressed data");
+			}
+		}
+		catch (...) {
+			if (m_zs.avail_out == total) throw;
+			m_error = std::current_exception();
+		}
+		return total - m_zs.avail_out;
+	}
+
+private:
+	bool _read_input() {
+		m_is->read(m_in.data(), m_in.size());
+		auto got = m_is->gcount();
+		m_zs.next_in = reinterpret_cast<Bytef*>(m_in.data());
+		m_zs.avail_in = uInt(got);
+		return got > 0;
+	}
+
+	z_stream m_zs{};
+	std::istream* m_is;
+	std::vector<char> m_in;
+	bool m_multi;
+	bool m_done = false;
+	std::exception_ptr m_error;
+};
+
+// without threaded, inflates a block whenever the parser runs out
+// with threaded, a helper thread inflates into one of two blocks while the parser reads the other,
+// an error is kept with the block after the last good one, so it surfaces at the same byte either way
+template<>
+class reader_interface<zlib_istream> : public buffered_reader
+{
+public:
+	reader_interface(zlib_istream& src) : m_inflater(src) {
+		size_t n = std::max<size_t>(src.buffer_size, 1);
+		m_block[0].data.resize(n);
+		if (src.threaded) {
+			m_block[1].data.resize(n);
+			m_thread = std::thread([this] { _inflate_loop(); });
+		}
+	}
+
+	~reader_interface() {
+		if (!m_thread.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lk(m_mutex);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+protected:
+	bool refill() override {
+		if (!m_thread.joinable()) {
+			auto& blk = m_block[0];
+			blk.size = m_inflater.inflate_some(blk.data.data(), blk.data.size());
+			cur = blk.data.data();
+			end = cur + blk.size;
+			return blk.size != 0;
+		}
+
+		std::unique_lock<std::mutex> lk(m_mutex);
+		if (m_current >= 0) {
+			if (m_block[m_current].last) return false;
+			m_block[m_current].full = false;	// hand it back to the helper
+			m_cv.notify_all();
+			m_current ^= 1;
+		}
+		else m_current = 0;
+		m_cv.wait(lk, [&] { return m_block[m_current].full; });
+
+		auto& blk = m_block[m_current];
+		if (blk.error) std::rethrow_exception(blk.error);
+		cur = blk.data.data();
+		end = cur + blk.size;
+		return blk.size != 0;
+	}
+
+private:
+	struct block {
+		std::vector<char> data;
+		size_t size = 0;
+		bool full = false;	// owned by the parser until it asks for the next block
+		bool last = false;
+		std::exception_ptr error;	// thrown once the parser gets here
+	};
+
+	void _inflate_loop() {
+		for (int i = 0;; i ^= 1) {
+			auto& blk = m_block[i];
+			{
+				std::unique_lock<std::mutex> lk(m_mutex);
+				m_cv.wait(lk, [&] { return !blk.full || m_stop; });
+				if (m_stop) return;
+			}
+			size_t n = 0;
+			std::exception_ptr error;
+			try {
+				n = m_inflater.inflate_some(blk.data.data(), blk.data.size());
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			{
+				std::lock_guard<std::mutex> lk(m_mutex);
+				blk.size = n;
+				blk.last = n == 0 || error;
+				blk.full = true;
+				blk.error = error;
+			}
+			m_cv.notify_all();
+			if (blk.last) return;
+		}
+	}
+
+	_inflater m_inflater;
+	block m_block[2];
+	int m_current = -1;
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stop = false;
+};
+
+// buffers the output and deflates it a block at a time
+template<>
+class writer_interface<zlib_ostream> : public writer
+{
+public:
+	writer_interface(zlib_ostream& dst) : m_os(&dst.os) {
+		size_t n = std::clamp<size_t>(dst.buffer_size, 1, UINT_MAX);
+		m_in.resize(n);
+		m_out.resize(n);
+		if (deflateInit2(&m_zs, dst.level, Z_DEFLATED, _zlib_window_bits(dst.format, false), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			throw std::runtime_error("deflateInit2 failed");
+	}
+
+	// not finished here, a dump that threw halfway leaves the compressed stream visibly incomplete
+	~writer_interface() { deflateEnd(&m_zs); }
+
+	writer_interface(const writer_interface&) = delete;
+	writer_interface& operator=(const writer_interface&) = delete;
+
+	void write(char ch) override {
+		if (m_used == m_in.size()) _flush();
+		m_in[m_used++] = ch;
+	}
+
+	void write(const char* str, size_t n) override {
+		if (n <= m_in.size() - m_used) {
+			memcpy(m_in.data() + m_used, str, n);
+			m_used += n;
+			return;
+		}
+		_flush();
+		if (n < m_in.size()) {
+			memcpy(m_in.data(), str, n);
+			m_used = n;
+		}
+		else _deflate(str, n, Z_NO_FLUSH);	// big enough to skip the copy
+	}
+
+	// finishes the stream, called at the end of dump(), anything written afterwards starts a new member
+	void flush() override {
+		_deflate(m_in.data(), m_used, Z_FINISH);
+		m_used = 0;
+		deflateReset(&m_zs);
+		m_os->flush();
+		if (!*m_os) throw std::runtime_error("failed to write compressed data");
+	}
+
+private:
+	void _flush() {
+		_deflate(m_in.data(), m_used, Z_NO_FLUSH);
+		m_used = 0;
+	}
+
+	void _deflate(const char* str, size_t n, int flush) {
+		m_zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(str));
+		for (;;) {
+			size_t chunk = std::min<size_t>(n, UINT_MAX);
+			m_zs.avail_in = uInt(chunk);
+			n -= chunk;
+			int f = n ? Z_NO_FLUSH : flush;
+			int r;
+			do {
+				m_zs.next_out = reinterpret_cast<Bytef*>(m_out.data());
+				m_zs.avail_out = uInt(m_out.size());
+				r = ::deflate(&m_zs, f);
+				if (r == Z_STREAM_ERROR) throw std::runtime_error("deflate failed");
+				m_os->write(m_out.data(), m_out.size() - m_zs.avail_out);
+			} while (m_zs.avail_out == 0 || (f == Z_FINISH && r == Z_OK));
+			if (n == 0) return;
+		}
+	}
+
+	z_stream m_zs{};
+	std::ostream* m_os;
+	std::vector<char> m_in;
+	std::vector<char> m_out;
+	size_t m_used = 0;
+};
+
+}
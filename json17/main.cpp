@@ -60,7 +60,7 @@ int main2()
 	std::string str = R"(
 {
 	"123":"456\n\r",
-	"this": [true, null, false, 127e25, -13, 7.e-34],
+	"this": [true, null, false, 127e25, -13, 7.0e-34],
 	"that": { "\u0033": "\ufffd\ufffd", "\ud852\uDF62": []},
 	"what": [{}],
 	"dcicxcl\bdsljfh": "null"